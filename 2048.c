@@ -1,11 +1,23 @@
+#define _POSIX_C_SOURCE 200809L
+#include "array.h"
+#include "classic.h"
+#include "hint.h"
+#include "latency.h"
+#include <assert.h>
 #include <math.h>
+#include <pthread.h>
 #include <raylib.h>
 #include <raymath.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #define BACKGROUND_COLOR GetColor(0x574A3EFF)
-#define BOARD_ROWS 4
-#define BOARD_COLS 4
+#define BOARD_ROWS CLASSIC_ROWS
+#define BOARD_COLS CLASSIC_COLS
 #define MAX_TILES (BOARD_ROWS * BOARD_COLS)
 #define MAX_APPEARS 2
 #define MAX_MERGES ((int)(MAX_TILES / 2))
@@ -20,27 +32,43 @@
 #define APPEAR_ANIMATION_DURATION 0.2
 #define SCALE_UP_ANIMATION_DURATION 0.2
 #define SCALE_DOWN_ANIMATION_DURATION 0.2
-
+#define TURN_ANIMATION_DURATION                                                \
+  (MOVE_ANIMATION_DURATION +                                                   \
+   fmax(APPEAR_ANIMATION_DURATION,                                             \
+        SCALE_UP_ANIMATION_DURATION + SCALE_DOWN_ANIMATION_DURATION))
+#define SIMULATION_TICK (1.0f / 120)
+#define MAX_TICKS_PER_FRAME 30
+#define DEFAULT_FPS 60
+#define RENDER_FPS 60
+#define RENDER_QUEUE_SIZE 32
+#define MAX_ENCODE_THREADS 16
+#define SESSION_MAGIC "2048SES1"
+#define SESSION_MAGIC_SIZE 8
+#define AUTO_PLAY_MIN_DEPTH 3
+
+// Everything UpdateGame reads from raylib in one frame. Sessions store one of
+// these per frame: a byte of moves and the frame time as a float.
 typedef struct {
-  int row;
-  int col;
-} BoardPosition;
+  uint8_t moves; // 1 << MoveDirection for every move key pressed
+  float frame_time;
+} FrameInput;
 
-typedef enum {
-  TILE_IDLE,
-  TILE_MOVE,
-  TILE_MERGE,
-  TILE_APPEAR,
-} TileType;
+typedef struct {
+  FrameInput *items;
+  size_t count;
+  size_t capacity;
+} FrameInputs;
 
 typedef struct {
   TileType type;
   Vector2 pos;
+  Vector2 prev_pos;
   Vector2 from_pos;
   Vector2 to_pos;
   int number;
   int new_number;
   float scale;
+  float prev_scale;
 } Tile;
 
 static const int screenWidth = 800;
@@ -48,17 +76,30 @@ static const int screenHeight = 800;
 
 static int tile_map[BOARD_ROWS][BOARD_COLS];
 
+// tiles[] animates the last turn. Moves only touch tile_map, tiles[] is
+// rebuilt from the map before the turn, its move and tile_map once something
+// needs to animate or draw it, see DeriveTiles.
 static Tile tiles[MAX_TILES + MAX_MERGES];
 static int tiles_count = 0;
+static int previous_map[BOARD_ROWS][BOARD_COLS];
+static MoveDirection previous_move = MOVE_COUNT;
+static bool tiles_stale = false;
 
-static bool merge_map[BOARD_ROWS][BOARD_COLS];
+static Score score = {0};
 
 static bool animation_active = true;
 static float animation_elapsed_time = 0.0f;
+static float tick_accumulator = 0.0f;
+
+static const char *move_names[MOVE_COUNT] = {"left", "right", "up", "down"};
+static FILE *record_file = NULL;
+static FILE *session_file = NULL;
+static bool measure_latency = false;
+static LatencyTracker latency;
 
 static void InitGame(void);
-static void UpdateGame(void);
-static void DrawGame(void);
+static bool UpdateGame(FrameInput input);
+static void DrawGame(const Hint *hint);
 
 static Vector2 GetTilePosition(int row, int col) {
   return (Vector2){.x = col * TILE_WIDTH + ((col + 1) * TILE_GAP_SIZE),
@@ -67,6 +108,14 @@ static Vector2 GetTilePosition(int row, int col) {
 
 static bool IsCellEmpty(int tile) { return tile == 0; }
 
+static void AddCell(int row, int col) {
+  tile_map[row][col] = 2;
+  tiles_stale = true;
+  if (record_file != NULL) {
+    fprintf(record_file, "spawn %d %d\n", row, col);
+  }
+}
+
 static void AddRandomCell(void) {
   BoardPosition empty_cells[MAX_TILES];
   size_t empty_cells_count = 0;
@@ -85,36 +134,37 @@ static void AddRandomCell(void) {
   }
   int r = GetRandomValue(0, empty_cells_count - 1);
   BoardPosition choosen = empty_cells[r];
-  tile_map[choosen.row][choosen.col] = 2;
-  Vector2 pos = GetTilePosition(choosen.row, choosen.col);
-  tiles[tiles_count++] = (Tile){.type = TILE_APPEAR,
-                                .number = 2,
-                                .new_number = 2,
-                                .scale = 0,
-                                .from_pos = pos,
-                                .to_pos = pos,
-                                .pos = pos};
+  AddCell(choosen.row, choosen.col);
 }
 
-static void InitGame(void) {
+static void ResetGame(void) {
   animation_active = true;
   animation_elapsed_time = MOVE_ANIMATION_DURATION;
   tiles_count = 0;
+  score = (Score){0};
 
   for (int row = 0; row < BOARD_ROWS; row++) {
     for (int col = 0; col < BOARD_COLS; col++) {
       tile_map[row][col] = 0;
+      previous_map[row][col] = 0;
     }
   }
+  previous_move = MOVE_COUNT;
+  tiles_stale = true;
 
   for (int i = 0; i < MAX_TILES; i++) {
     tiles[i].scale = 1;
+    tiles[i].prev_scale = 1;
     tiles[i].type = TILE_IDLE;
     tiles[i].pos = Vector2Zero();
+    tiles[i].prev_pos = Vector2Zero();
     tiles[i].from_pos = Vector2Zero();
     tiles[i].to_pos = Vector2Zero();
   }
+}
 
+static void InitGame(void) {
+  ResetGame();
   AddRandomCell();
   AddRandomCell();
 }
@@ -123,239 +173,66 @@ static Vector2 LerpVector2(Vector2 start, Vector2 end, float amount) {
   return Vector2Add(start, Vector2Scale((Vector2Subtract(end, start)), amount));
 }
 
-static int CalculateTargetColLeft(int cell, int row, int col) {
-  int target_col = col;
-  for (; target_col > 0; target_col--)
-    if (!IsCellEmpty(tile_map[row][target_col - 1]))
-      break;
-
-  if (target_col > 0 && tile_map[row][target_col - 1] == cell &&
-      !merge_map[row][target_col - 1]) {
-    target_col--;
-  }
-  return target_col;
-}
-
-static int CalculateTargetColRight(int cell, int row, int col) {
-  int target_col = col;
-  for (; target_col < BOARD_COLS - 1; target_col++)
-    if (!IsCellEmpty(tile_map[row][target_col + 1]))
-      break;
-
-  if (target_col < BOARD_COLS - 1 && tile_map[row][target_col + 1] == cell &&
-      !merge_map[row][target_col + 1])
-    target_col++;
-  return target_col;
-}
-
-static int CalculateTargetRowUp(int cell, int row, int col) {
-  int target_row = row;
-  for (; target_row > 0; target_row--)
-    if (!IsCellEmpty(tile_map[target_row - 1][col]))
-      break;
-
-  if (target_row > 0 && tile_map[target_row - 1][col] == cell &&
-      !merge_map[target_row - 1][col])
-    target_row--;
-  return target_row;
-}
-
-static int CalculateTargetRowDown(int cell, int row, int col) {
-  int target_row = row;
-  for (; target_row < BOARD_ROWS - 1; target_row++)
-    if (!IsCellEmpty(tile_map[target_row + 1][col]))
-      break;
-
-  if (target_row < BOARD_COLS - 1 && tile_map[target_row + 1][col] == cell &&
-      !merge_map[target_row + 1][col])
-    target_row++;
-  return target_row;
-}
-
-// static BoardPosition CalculateTargetPosition(int cell, BoardPosition pos) {
-//     CalculateTargetColLeft(cell, pos.row, pos.col);
-// }
-
-static void MoveTile(int cell, int row, int col, int target_row,
-                     int target_col) {
-  Vector2 from_pos = GetTilePosition(row, col);
-  Vector2 to_pos = GetTilePosition(target_row, target_col);
-
-  if (col == target_col && row == target_row) {
-    tiles[tiles_count++] = (Tile){.type = TILE_IDLE,
-                                  .scale = 1,
-                                  .new_number = cell,
-                                  .number = cell,
-                                  .from_pos = from_pos,
-                                  .to_pos = to_pos,
-                                  .pos = from_pos};
-  } else if (!IsCellEmpty(tile_map[target_row][target_col])) {
-    tiles[tiles_count++] = (Tile){.type = TILE_MERGE,
-                                  .scale = 1,
-                                  .new_number = cell * 2,
-                                  .number = cell,
-                                  .from_pos = from_pos,
-                                  .to_pos = to_pos,
-                                  .pos = from_pos};
-    tile_map[row][col] = 0;
-    tile_map[target_row][target_col] = cell * 2;
-    merge_map[target_row][target_col] = true;
-  } else {
-    tiles[tiles_count++] = (Tile){.type = TILE_MOVE,
-                                  .scale = 1,
-                                  .new_number = cell,
-                                  .number = cell,
-                                  .from_pos = from_pos,
-                                  .to_pos = to_pos,
-                                  .pos = from_pos};
-    tile_map[row][col] = 0;
-    tile_map[target_row][target_col] = cell;
-  }
-}
-
-static void MoveLeft(void) {
-  for (int row = 0; row < BOARD_ROWS; row++) {
-    for (int col = 0; col < BOARD_COLS; col++) {
-      merge_map[row][col] = false;
-    }
-  }
-
-  for (int row = 0; row < BOARD_ROWS; row++) {
-    for (int col = 0; col < BOARD_COLS; col++) {
-      int cell = tile_map[row][col];
-      if (IsCellEmpty(cell))
-        continue;
-
-      int target_col = CalculateTargetColLeft(cell, row, col);
-      MoveTile(cell, row, col, row, target_col);
-    }
-  }
-}
-
-static void MoveRight(void) {
-  for (int row = 0; row < BOARD_ROWS; row++) {
-    for (int col = 0; col < BOARD_COLS; col++) {
-      merge_map[row][col] = false;
-    }
-  }
-
-  for (int row = 0; row < BOARD_ROWS; row++) {
-    for (int col = BOARD_COLS - 1; col >= 0; col--) {
-      int cell = tile_map[row][col];
-      if (IsCellEmpty(cell))
-        continue;
-
-      int target_col = CalculateTargetColRight(cell, row, col);
-      MoveTile(cell, row, col, row, target_col);
-    }
-  }
+static Tile MakeTile(TileStep step) {
+  Vector2 from_pos = GetTilePosition(step.from.row, step.from.col);
+  float scale = step.type == TILE_APPEAR ? 0 : 1;
+  return (Tile){.type = step.type,
+                .scale = scale,
+                .prev_scale = scale,
+                .new_number = step.new_number,
+                .number = step.number,
+                .from_pos = from_pos,
+                .to_pos = GetTilePosition(step.to.row, step.to.col),
+                .pos = from_pos,
+                .prev_pos = from_pos};
 }
 
-static void MoveUp(void) {
-  for (int row = 0; row < BOARD_ROWS; row++) {
-    for (int col = 0; col < BOARD_COLS; col++) {
-      merge_map[row][col] = false;
-    }
-  }
-
-  for (int row = 0; row < BOARD_ROWS; row++) {
-    for (int col = 0; col < BOARD_COLS; col++) {
-      int cell = tile_map[row][col];
-      if (IsCellEmpty(cell))
-        continue;
-
-      int target_row = CalculateTargetRowUp(cell, row, col);
-      MoveTile(cell, row, col, target_row, col);
-    }
+// Rebuilds tiles[] from (previous_map, previous_move, tile_map), see
+// DeriveTileSteps.
+static void DeriveTiles(void) {
+  TileSteps steps;
+  DeriveTileSteps(previous_map, previous_move, tile_map, &steps);
+  for (int i = 0; i < steps.count; i++) {
+    tiles[i] = MakeTile(steps.items[i]);
   }
+  tiles_count = steps.count;
+  tiles_stale = false;
 }
 
-static void MoveDown(void) {
-  for (int row = 0; row < BOARD_ROWS; row++) {
-    for (int col = 0; col < BOARD_COLS; col++) {
-      merge_map[row][col] = false;
-    }
-  }
-
-  for (int row = BOARD_ROWS - 1; row >= 0; row--) {
-    for (int col = 0; col < BOARD_COLS; col++) {
-      int cell = tile_map[row][col];
-      if (IsCellEmpty(cell))
-        continue;
-
-      int target_row = CalculateTargetRowDown(cell, row, col);
-      MoveTile(cell, row, col, target_row, col);
-    }
-  }
+static void SyncTiles(void) {
+  if (tiles_stale)
+    DeriveTiles();
 }
 
-static bool AnyMoveHappen(void) {
-  for (int i = 0; i < tiles_count; i++) {
-    if (tiles[i].type == TILE_MOVE || tiles[i].type == TILE_MERGE) {
-      return true;
-    }
+// Every press restarts the turn animation, as it always did. One that moves
+// nothing leaves tile_map as it is and so shows every tile idle.
+static bool MoveGame(MoveDirection dir) {
+  memcpy(previous_map, tile_map, sizeof(previous_map));
+  previous_move = dir;
+  tiles_stale = true;
+  animation_elapsed_time = 0;
+  if (!SlideTileMap(tile_map, dir, &score, NULL))
+    return false;
+
+  if (record_file != NULL) {
+    fprintf(record_file, "move %s\n", move_names[dir]);
   }
-  return false;
+  return true;
 }
 
-static bool IsGameLost(void) {
-  int prev_value = -1;
-  for (int row = 0; row < BOARD_ROWS; row++) {
-    for (int col = 0; col < BOARD_COLS; col++) {
-      if (IsCellEmpty(tile_map[row][col]) || tile_map[row][col] == prev_value) {
-        return false;
-      }
-      prev_value = tile_map[row][col];
-    }
-  }
-  prev_value = -1;
-  for (int col = 0; col < BOARD_COLS; col++) {
-    for (int row = 0; row < BOARD_ROWS; row++) {
-      if (tile_map[row][col] == prev_value) {
-        return false;
-      }
-      prev_value = tile_map[row][col];
-    }
+static bool PlayMove(MoveDirection dir) {
+  if (!MoveGame(dir))
+    return false;
+  if (!IsTileMapLost(tile_map)) {
+    AddRandomCell();
   }
   return true;
 }
 
-static void UpdateGame(void) {
-  if (IsKeyPressed(KEY_A)) {
-    tiles_count = 0;
-    animation_elapsed_time = 0;
-    MoveLeft();
-    if (AnyMoveHappen() && !IsGameLost()) {
-      AddRandomCell();
-    }
-  }
-  if (IsKeyPressed(KEY_D)) {
-    tiles_count = 0;
-    animation_elapsed_time = 0;
-    MoveRight();
-    if (AnyMoveHappen() && !IsGameLost()) {
-      AddRandomCell();
-    }
-  }
-  if (IsKeyPressed(KEY_W)) {
-    tiles_count = 0;
-    animation_elapsed_time = 0;
-    MoveUp();
-    if (AnyMoveHappen() && !IsGameLost()) {
-      AddRandomCell();
-    }
-  }
-  if (IsKeyPressed(KEY_S)) {
-    tiles_count = 0;
-    animation_elapsed_time = 0;
-    MoveDown();
-    if (AnyMoveHappen() && !IsGameLost()) {
-      AddRandomCell();
-    }
-  }
-
+static void UpdateAnimations(float delta_time) {
+  SyncTiles();
   // if (animation_active) {
-  animation_elapsed_time += GetFrameTime();
+  animation_elapsed_time += delta_time;
   // }
 
   for (int i = 0; i < tiles_count; i++) {
@@ -418,6 +295,73 @@ static void UpdateGame(void) {
   }
 }
 
+static FrameInput ReadFrameInput(void) {
+  static const int move_keys[MOVE_COUNT] = {
+      [MOVE_LEFT] = KEY_A,
+      [MOVE_RIGHT] = KEY_D,
+      [MOVE_UP] = KEY_W,
+      [MOVE_DOWN] = KEY_S,
+  };
+  FrameInput input = {.frame_time = GetFrameTime()};
+  for (int dir = 0; dir < MOVE_COUNT; dir++) {
+    if (IsKeyPressed(move_keys[dir]))
+      input.moves |= 1 << dir;
+  }
+  return input;
+}
+
+static void WriteFrameInput(FrameInput input) {
+  if (session_file != NULL) {
+    fwrite(&input.moves, sizeof(input.moves), 1, session_file);
+    fwrite(&input.frame_time, sizeof(input.frame_time), 1, session_file);
+  }
+}
+
+static PackedBoard PackTileMap(void) {
+  PackedBoard packed = 0;
+  for (int row = 0; row < BOARD_ROWS; row++) {
+    for (int col = 0; col < BOARD_COLS; col++) {
+      int exponent = 0;
+      for (int cell = tile_map[row][col]; cell > 1; cell >>= 1)
+        exponent++;
+      packed |= (PackedBoard)exponent << (4 * (row * BOARD_COLS + col));
+    }
+  }
+  return packed;
+}
+
+// Returns whether any of the moves changed the board.
+static bool UpdateGame(FrameInput input) {
+  bool moved = false;
+  for (int dir = 0; dir < MOVE_COUNT; dir++) {
+    if ((input.moves & (1 << dir)) && PlayMove(dir))
+      moved = true;
+  }
+
+  // Animations advance in fixed ticks no matter how fast frames are drawn.
+  // After a very long frame the backlog is dropped instead of replayed.
+  tick_accumulator += input.frame_time;
+  int ticks = 0;
+  while (tick_accumulator >= SIMULATION_TICK && ticks < MAX_TICKS_PER_FRAME) {
+    for (int i = 0; i < tiles_count; i++) {
+      tiles[i].prev_pos = tiles[i].pos;
+      tiles[i].prev_scale = tiles[i].scale;
+    }
+    UpdateAnimations(SIMULATION_TICK);
+    tick_accumulator -= SIMULATION_TICK;
+    ticks++;
+  }
+  if (ticks == MAX_TICKS_PER_FRAME)
+    tick_accumulator = 0;
+  return moved;
+}
+
+static Tile InterpolateTile(Tile tile, float alpha) {
+  tile.pos = LerpVector2(tile.prev_pos, tile.pos, alpha);
+  tile.scale = Lerp(tile.prev_scale, tile.scale, alpha);
+  return tile;
+}
+
 static Color GetTileColor(int number) {
   switch (number) {
   case 2:
@@ -467,8 +411,9 @@ static void DrawTile(Tile tile) {
            tile.pos.y + (TILE_HEIGHT / 2) - 22, font_size, LIGHTGRAY);
 }
 
-static void DrawGame(void) {
-  BeginDrawing();
+// alpha is how far we are between the last two simulation ticks.
+static void DrawGameFrame(float alpha) {
+  SyncTiles();
   ClearBackground(BACKGROUND_COLOR);
 
   for (int row = 0; row < BOARD_ROWS; row++) {
@@ -483,21 +428,440 @@ static void DrawGame(void) {
   }
 
   for (int i = 0; i < tiles_count; i++) {
-    DrawTile(tiles[i]);
+    DrawTile(InterpolateTile(tiles[i], alpha));
   }
 
+  const char *score_str = TextFormat("Score: %llu",
+                                     (unsigned long long)score.points);
+  DrawText(score_str,
+           screenWidth - TILE_GAP_SIZE - MeasureText(score_str, 18), 2, 18,
+           LIGHTGRAY);
+}
+
+static void DrawLatency(const LatencyStats *stats) {
+  DrawText(TextFormat("Latency p50/p95/max  display %.1f/%.1f/%.1f ms  "
+                      "settle %.1f/%.1f/%.1f ms",
+                      stats->display_p50, stats->display_p95,
+                      stats->display_max, stats->settle_p50,
+                      stats->settle_p95, stats->settle_max),
+           TILE_GAP_SIZE, screenHeight - 20, 18, LIGHTGRAY);
+}
+
+static bool IsTurnAnimating(void) {
+  return animation_elapsed_time < TURN_ANIMATION_DURATION;
+}
+
+static void DrawHint(Hint hint) {
+  static const char *direction_names[DIRECTION_COUNT] = {
+      [DIRECTION_LEFT] = "LEFT",
+      [DIRECTION_RIGHT] = "RIGHT",
+      [DIRECTION_UP] = "UP",
+      [DIRECTION_DOWN] = "DOWN",
+  };
+  DrawText(TextFormat("Hint: %s (depth %d)", direction_names[hint.direction],
+                      hint.depth),
+           TILE_GAP_SIZE, 2, 18, LIGHTGRAY);
+}
+
+// hint is NULL when none should be shown.
+static void DrawGame(const Hint *hint) {
+  BeginDrawing();
+  DrawGameFrame(tick_accumulator / SIMULATION_TICK);
+  if (hint != NULL)
+    DrawHint(*hint);
+  if (measure_latency)
+    DrawLatency(&latency.recent);
   EndDrawing();
+  if (measure_latency)
+    TrackFrameSubmitted(&latency, IsTurnAnimating());
+}
+
+typedef struct {
+  Image image;
+  int index;
+} EncodeJob;
+
+typedef struct {
+  EncodeJob jobs[RENDER_QUEUE_SIZE];
+  int head;
+  int count;
+  bool done;
+  pthread_mutex_t mutex;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+  const char *output_dir;
+  const char *format;
+  int failures;
+} EncodeQueue;
+
+static EncodeQueue encode_queue = {.mutex = PTHREAD_MUTEX_INITIALIZER,
+                                   .not_empty = PTHREAD_COND_INITIALIZER,
+                                   .not_full = PTHREAD_COND_INITIALIZER};
+
+static void PushEncodeJob(EncodeJob job) {
+  pthread_mutex_lock(&encode_queue.mutex);
+  while (encode_queue.count == RENDER_QUEUE_SIZE)
+    pthread_cond_wait(&encode_queue.not_full, &encode_queue.mutex);
+  int tail = (encode_queue.head + encode_queue.count) % RENDER_QUEUE_SIZE;
+  encode_queue.jobs[tail] = job;
+  encode_queue.count++;
+  pthread_cond_signal(&encode_queue.not_empty);
+  pthread_mutex_unlock(&encode_queue.mutex);
+}
+
+static bool PopEncodeJob(EncodeJob *job) {
+  pthread_mutex_lock(&encode_queue.mutex);
+  while (encode_queue.count == 0 && !encode_queue.done)
+    pthread_cond_wait(&encode_queue.not_empty, &encode_queue.mutex);
+  bool has_job = encode_queue.count > 0;
+  if (has_job) {
+    *job = encode_queue.jobs[encode_queue.head];
+    encode_queue.head = (encode_queue.head + 1) % RENDER_QUEUE_SIZE;
+    encode_queue.count--;
+    pthread_cond_signal(&encode_queue.not_full);
+  }
+  pthread_mutex_unlock(&encode_queue.mutex);
+  return has_job;
+}
+
+static void *RunEncoder(void *arg) {
+  (void)arg;
+  EncodeJob job;
+  while (PopEncodeJob(&job)) {
+    // Render textures come back bottom-up.
+    ImageFlipVertical(&job.image);
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/frame_%06d.%s", encode_queue.output_dir,
+             job.index, encode_queue.format);
+    if (!ExportImage(job.image, path)) {
+      fprintf(stderr, "ERROR: could not write %s\n", path);
+      pthread_mutex_lock(&encode_queue.mutex);
+      encode_queue.failures++;
+      pthread_mutex_unlock(&encode_queue.mutex);
+    }
+    UnloadImage(job.image);
+  }
+  return NULL;
+}
+
+static int RenderTurn(RenderTexture2D target, int frame_index) {
+  int frames = ceil(TURN_ANIMATION_DURATION * RENDER_FPS);
+  for (int i = 0; i < frames; i++) {
+    UpdateAnimations(1.0f / RENDER_FPS);
+    BeginTextureMode(target);
+    DrawGameFrame(1);
+    EndTextureMode();
+    PushEncodeJob((EncodeJob){.image = LoadImageFromTexture(target.texture),
+                              .index = frame_index++});
+  }
+  return frame_index;
+}
+
+static bool ParseMoveName(const char *name, MoveDirection *dir) {
+  for (int i = 0; i < MOVE_COUNT; i++) {
+    if (strcmp(name, move_names[i]) == 0) {
+      *dir = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Replays a file written by --record into one image per animation frame at
+// RENDER_FPS, as fast as the GPU allows. Drawing stays on this thread, PNG
+// encoding is spread over a pool of encoder threads.
+static int RenderReplay(const char *replay_path, const char *output_dir,
+                        const char *format) {
+  FILE *replay = fopen(replay_path, "r");
+  if (replay == NULL) {
+    fprintf(stderr, "ERROR: could not open %s\n", replay_path);
+    return 1;
+  }
+
+  SetTraceLogLevel(LOG_WARNING);
+  SetConfigFlags(FLAG_WINDOW_HIDDEN);
+  InitWindow(screenWidth, screenHeight, "2048");
+  RenderTexture2D target = LoadRenderTexture(screenWidth, screenHeight);
+
+  encode_queue.output_dir = output_dir;
+  encode_queue.format = format;
+  int encoder_count = sysconf(_SC_NPROCESSORS_ONLN);
+  if (encoder_count < 1)
+    encoder_count = 1;
+  if (encoder_count > MAX_ENCODE_THREADS)
+    encoder_count = MAX_ENCODE_THREADS;
+  pthread_t encoders[MAX_ENCODE_THREADS];
+  for (int i = 0; i < encoder_count; i++) {
+    pthread_create(&encoders[i], NULL, RunEncoder, NULL);
+  }
+
+  ResetGame();
+  int frame_index = 0;
+  bool turn_pending = false;
+  char line[64];
+  for (int line_number = 1; fgets(line, sizeof(line), replay) != NULL;
+       line_number++) {
+    int row, col;
+    char name[16];
+    MoveDirection dir;
+    if (sscanf(line, "spawn %d %d", &row, &col) == 2 && row >= 0 &&
+        row < BOARD_ROWS && col >= 0 && col < BOARD_COLS) {
+      AddCell(row, col);
+      turn_pending = true;
+    } else if (sscanf(line, "move %15s", name) == 1 &&
+               ParseMoveName(name, &dir)) {
+      if (turn_pending)
+        frame_index = RenderTurn(target, frame_index);
+      MoveGame(dir);
+      turn_pending = true;
+    } else {
+      fprintf(stderr, "%s:%d: skipping invalid line\n", replay_path,
+              line_number);
+    }
+  }
+  if (turn_pending)
+    frame_index = RenderTurn(target, frame_index);
+  fclose(replay);
+
+  pthread_mutex_lock(&encode_queue.mutex);
+  encode_queue.done = true;
+  pthread_cond_broadcast(&encode_queue.not_empty);
+  pthread_mutex_unlock(&encode_queue.mutex);
+  for (int i = 0; i < encoder_count; i++) {
+    pthread_join(encoders[i], NULL);
+  }
+
+  UnloadRenderTexture(target);
+  CloseWindow();
+  if (encode_queue.failures > 0) {
+    fprintf(stderr, "ERROR: %d of %d frames could not be written\n",
+            encode_queue.failures, frame_index);
+    return 1;
+  }
+  printf("Rendered %d frames to %s\n", frame_index, output_dir);
+  return 0;
+}
+
+static double GetSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int CompareSeconds(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void PrintPhaseTimes(const char *name, double *times, size_t count) {
+  double total = 0;
+  for (size_t i = 0; i < count; i++) {
+    total += times[i];
+  }
+  qsort(times, count, sizeof(*times), CompareSeconds);
+  printf("%-8s total %9.2f ms  mean %8.2f us  p50 %8.2f us  p99 %8.2f us  "
+         "max %8.2f us\n",
+         name, total * 1e3, total / count * 1e6, times[count / 2] * 1e6,
+         times[count * 99 / 100] * 1e6, times[count - 1] * 1e6);
+}
+
+static bool LoadSession(const char *session_path, unsigned int *seed,
+                        FrameInputs *frames) {
+  FILE *session = fopen(session_path, "rb");
+  if (session == NULL) {
+    fprintf(stderr, "ERROR: could not open %s\n", session_path);
+    return false;
+  }
+  char magic[SESSION_MAGIC_SIZE];
+  uint32_t stored_seed;
+  if (fread(magic, 1, sizeof(magic), session) != sizeof(magic) ||
+      memcmp(magic, SESSION_MAGIC, sizeof(magic)) != 0 ||
+      fread(&stored_seed, sizeof(stored_seed), 1, session) != 1) {
+    fprintf(stderr, "ERROR: %s is not a session\n", session_path);
+    fclose(session);
+    return false;
+  }
+  *seed = stored_seed;
+
+  FrameInput input;
+  while (fread(&input.moves, sizeof(input.moves), 1, session) == 1 &&
+         fread(&input.frame_time, sizeof(input.frame_time), 1, session) == 1) {
+    da_append(frames, input);
+  }
+  fclose(session);
+  return true;
 }
 
-int main(void) {
+// Feeds a session written by --session back through UpdateGame and the
+// drawing code as fast as possible, into an offscreen texture, and reports how
+// long each phase took per frame. Spawns come from the recorded seed, so the
+// same session always plays the same game. Draw times are what the CPU spends
+// building and submitting the frame, the GPU catches up on its own.
+static int BenchSession(const char *session_path) {
+  unsigned int seed;
+  FrameInputs frames = {0};
+  if (!LoadSession(session_path, &seed, &frames))
+    return 1;
+  if (frames.count == 0) {
+    fprintf(stderr, "ERROR: %s has no frames\n", session_path);
+    return 1;
+  }
+
+  SetTraceLogLevel(LOG_WARNING);
+  SetConfigFlags(FLAG_WINDOW_HIDDEN);
   InitWindow(screenWidth, screenHeight, "2048");
-  SetTargetFPS(60);
+  RenderTexture2D target = LoadRenderTexture(screenWidth, screenHeight);
+  SetRandomSeed(seed);
   InitGame();
 
+  double *update_times = malloc(frames.count * sizeof(double));
+  double *draw_times = malloc(frames.count * sizeof(double));
+  assert(update_times != NULL && draw_times != NULL && "Buy more RAM lol");
+  double recorded_time = 0;
+  double start = GetSeconds();
+  for (size_t i = 0; i < frames.count; i++) {
+    double update_start = GetSeconds();
+    UpdateGame(frames.items[i]);
+    double draw_start = GetSeconds();
+    BeginTextureMode(target);
+    DrawGameFrame(tick_accumulator / SIMULATION_TICK);
+    EndTextureMode();
+    double draw_end = GetSeconds();
+    update_times[i] = draw_start - update_start;
+    draw_times[i] = draw_end - draw_start;
+    recorded_time += frames.items[i].frame_time;
+  }
+  double replay_time = GetSeconds() - start;
+
+  printf("%zu frames, %.1f s recorded, replayed in %.1f ms (%.0f FPS)\n",
+         frames.count, recorded_time, replay_time * 1e3,
+         frames.count / replay_time);
+  PrintPhaseTimes("update", update_times, frames.count);
+  PrintPhaseTimes("draw", draw_times, frames.count);
+  printf("final score %llu, %llu merges\n", (unsigned long long)score.points,
+         (unsigned long long)score.merges);
+
+  free(update_times);
+  free(draw_times);
+  free(frames.items);
+  UnloadRenderTexture(target);
+  CloseWindow();
+  return 0;
+}
+
+static void Usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [--record <game>] [--session <session>] [--uncapped]\n"
+          "          [--latency <log.csv>]\n",
+          program);
+  fprintf(stderr, "       %s --render <game> <output dir> [png|raw]\n",
+          program);
+  fprintf(stderr, "       %s --bench <session>\n", program);
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 4 && strcmp(argv[1], "--render") == 0) {
+    const char *format = argc >= 5 ? argv[4] : "png";
+    if (argc > 5 ||
+        (strcmp(format, "png") != 0 && strcmp(format, "raw") != 0)) {
+      Usage(argv[0]);
+      return 1;
+    }
+    return RenderReplay(argv[2], argv[3], format);
+  }
+  if (argc == 3 && strcmp(argv[1], "--bench") == 0) {
+    return BenchSession(argv[2]);
+  }
+
+  bool uncapped = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--uncapped") == 0) {
+      uncapped = true;
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc &&
+               record_file == NULL) {
+      record_file = fopen(argv[++i], "w");
+      if (record_file == NULL) {
+        fprintf(stderr, "ERROR: could not open %s\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc &&
+               !measure_latency) {
+      if (!StartLatencyTracker(&latency, argv[++i]))
+        return 1;
+      measure_latency = true;
+    } else if (strcmp(argv[i], "--session") == 0 && i + 1 < argc &&
+               session_file == NULL) {
+      session_file = fopen(argv[++i], "wb");
+      if (session_file == NULL) {
+        fprintf(stderr, "ERROR: could not open %s\n", argv[i]);
+        return 1;
+      }
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+
+  InitWindow(screenWidth, screenHeight, "2048");
+  if (!uncapped) {
+    int refresh_rate = GetMonitorRefreshRate(GetCurrentMonitor());
+    SetTargetFPS(refresh_rate > 0 ? refresh_rate : DEFAULT_FPS);
+  }
+  if (session_file != NULL) {
+    // Seeding spawns ourselves lets --bench play back the very same game.
+    uint32_t seed = time(NULL);
+    SetRandomSeed(seed);
+    fwrite(SESSION_MAGIC, 1, SESSION_MAGIC_SIZE, session_file);
+    fwrite(&seed, sizeof(seed), 1, session_file);
+  }
+  InitGame();
+  HintEngine hint_engine;
+  StartHintEngine(&hint_engine);
+  RequestHint(&hint_engine, PackTileMap());
+
+  static const MoveDirection hint_moves[DIRECTION_COUNT] = {
+      [DIRECTION_LEFT] = MOVE_LEFT,
+      [DIRECTION_RIGHT] = MOVE_RIGHT,
+      [DIRECTION_UP] = MOVE_UP,
+      [DIRECTION_DOWN] = MOVE_DOWN,
+  };
+  bool show_hint = false;
+  bool auto_play = false;
   while (!WindowShouldClose()) {
-    UpdateGame();
-    DrawGame();
+    FrameInput input = ReadFrameInput();
+    // Only keyboard moves are timed, like in main.c.
+    bool pressed = input.moves != 0;
+    if (IsKeyPressed(KEY_H))
+      show_hint = !show_hint;
+    if (IsKeyPressed(KEY_P))
+      auto_play = !auto_play;
+
+    // Auto-play presses the key for the hint, so sessions replay it as is.
+    Hint hint;
+    bool has_hint = PollHint(&hint_engine, &hint);
+    if (auto_play && has_hint && hint.depth >= AUTO_PLAY_MIN_DEPTH &&
+        !IsTurnAnimating())
+      input.moves |= 1 << hint_moves[hint.direction];
+    WriteFrameInput(input);
+
+    if (UpdateGame(input)) {
+      if (measure_latency && pressed)
+        TrackMoveSeen(&latency);
+      // A hint for the board before this move must not be drawn.
+      RequestHint(&hint_engine, PackTileMap());
+      has_hint = false;
+    }
+    DrawGame((show_hint || auto_play) && has_hint ? &hint : NULL);
   }
 
+  StopHintEngine(&hint_engine);
+
+  if (record_file != NULL)
+    fclose(record_file);
+  if (session_file != NULL)
+    fclose(session_file);
+  if (measure_latency)
+    StopLatencyTracker(&latency);
   CloseWindow();
 }
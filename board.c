@@ -1,51 +1,16 @@
 #include "board.h"
 #include "animation.h"
+#include "palette.h"
 #include <raylib.h>
 #include <raymath.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static void MoveLeft(Board *board);
-static void MoveRight(Board *board);
-static void MoveUp(Board *board);
-static void MoveDown(Board *board);
+static void DeriveAnimation(Board *board);
 static Rectangle GetCellRect(int row, int col);
 static void DrawEmptyBoard(void);
 
-static Color GetCellColor(int number) {
-  switch (number) {
-  case 2:
-    return (Color){57, 42, 26, 255};
-  case 4:
-    return (Color){71, 54, 22, 255};
-  case 8:
-    return (Color){127, 65, 11, 255};
-  case 16:
-    return (Color){141, 54, 8, 255};
-  case 32:
-    return (Color){145, 33, 7, 255};
-  case 64:
-    return (Color){167, 37, 7, 255};
-  case 128:
-    return (Color){97, 77, 12, 255};
-  case 256:
-    return (Color){237, 197, 63, 255};
-  case 512:
-    return (Color){237, 200, 80, 255};
-  case 1024:
-    return (Color){237, 197, 63, 255};
-  case 2048:
-    return (Color){237, 194, 46, 255};
-  case 4096:
-    return (Color){237, 112, 46, 255};
-  case 8192:
-    return (Color){237, 76, 46, 255};
-  default:
-    return (Color){237, 76, 46, 255};
-  };
-}
-
 static Rectangle GetCellRect(int row, int col) {
   return (Rectangle){.height = CELL_HEIGHT,
                      .width = CELL_WIDTH,
@@ -167,6 +132,8 @@ static void DrawAnimationCells(Board *board) {
 }
 
 void DrawBoard(Board *board) {
+  if (board->animation_pending)
+    DeriveAnimation(board);
   DrawEmptyBoard();
   if (IsAnimationPlaying(&board->animation)) {
     DrawAnimationCells(board);
@@ -202,210 +169,76 @@ void AddRandomCell(Board *board) {
   int r = rand() % empty_cells_count;
   Point choosen = empty_cells[r];
   board->cells[choosen.y][choosen.x] = 2;
-  Vector2 pos = GetCellPosition(choosen.y, choosen.x);
-  AddAppearAnimation(&board->animation, 2, pos);
-}
-
-static bool AnyMoveHappen(Board *board) {
-  for (size_t i = 0; i < board->animation.moves.count; i++) {
-    Move move = board->animation.moves.items[i];
-    if (move.from.x != move.to.x || move.from.y != move.to.y)
-      return true;
-  }
-  return false;
 }
 
-void UpdateBoard(Board *board) {
-  if (IsKeyPressed(KEY_A)) {
-    ClearAnimations(&board->animation);
-    MoveLeft(board);
-    if (AnyMoveHappen(board)) {
-      board->animation.is_animation_playing = true;
-      AddRandomCell(board);
-    }
-  }
-  if (IsKeyPressed(KEY_D)) {
-    ClearAnimations(&board->animation);
-    MoveRight(board);
-    if (AnyMoveHappen(board)) {
-      board->animation.is_animation_playing = true;
-      AddRandomCell(board);
-    }
-  }
-  if (IsKeyPressed(KEY_W)) {
-    ClearAnimations(&board->animation);
-    MoveUp(board);
-    if (AnyMoveHappen(board)) {
-      board->animation.is_animation_playing = true;
-      AddRandomCell(board);
-    }
-  }
-  if (IsKeyPressed(KEY_S)) {
-    ClearAnimations(&board->animation);
-    MoveDown(board);
-    if (AnyMoveHappen(board)) {
-      board->animation.is_animation_playing = true;
-      AddRandomCell(board);
-    }
-  }
-
+// Every press restarts the animation, as it always did. One that moves
+// nothing keeps cells as they are and so animates every tile standing still.
+bool MoveBoard(Board *board, Direction dir) {
+  memcpy(board->previous_cells, board->cells, sizeof(board->cells));
+  board->previous_move = dir;
+  board->animation_pending = true;
+  ClearAnimations(&board->animation);
+  if (!SlideCells(board->cells, dir, &board->score, NULL))
+    return false;
+
+  board->animation.is_animation_playing = true;
+  AddRandomCell(board);
+  return true;
+}
+
+// Fills board->animation for the last move from the cells before it, its
+// direction and the cells after it, see DeriveCellSteps.
+static void DeriveAnimation(Board *board) {
+  CellSteps steps;
+  DeriveCellSteps(board->previous_cells, board->previous_move, board->cells,
+                  &steps);
+  for (size_t i = 0; i < steps.move_count; i++) {
+    CellMove move = steps.moves[i];
+    Vector2 to_pos = GetCellPosition(move.to.y, move.to.x);
+    AddMoveAnimation(&board->animation, move.number, move.is_merge,
+                     GetCellPosition(move.from.y, move.from.x), to_pos);
+    if (move.is_merge)
+      AddMergeAnimation(&board->animation, move.number * 2, to_pos);
+  }
+  for (size_t i = 0; i < steps.appear_count; i++) {
+    CellAppear appear = steps.appears[i];
+    AddAppearAnimation(&board->animation, appear.number,
+                       GetCellPosition(appear.in.y, appear.in.x));
+  }
+  board->animation_pending = false;
+}
+
+bool UpdateBoard(Board *board) {
+  bool moved = false;
+  if (IsKeyPressed(KEY_A) && MoveBoard(board, DIRECTION_LEFT))
+    moved = true;
+  if (IsKeyPressed(KEY_D) && MoveBoard(board, DIRECTION_RIGHT))
+    moved = true;
+  if (IsKeyPressed(KEY_W) && MoveBoard(board, DIRECTION_UP))
+    moved = true;
+  if (IsKeyPressed(KEY_S) && MoveBoard(board, DIRECTION_DOWN))
+    moved = true;
+
+  if (board->animation_pending)
+    DeriveAnimation(board);
   if (IsAnimationPlaying(&board->animation)) {
     UpdateAnimation(&board->animation);
   }
+  return moved;
 }
 
-static int CalculateTargetColLeft(Board *board, Cell cell, int row, int col,
-                                  bool merge_map[BOARD_ROWS][BOARD_COLS]) {
-  int target_col = col;
-  for (; target_col > 0; target_col--)
-    if (!IsCellEmpty(board->cells[row][target_col - 1]))
-      break;
-
-  if (target_col > 0 && board->cells[row][target_col - 1] == cell &&
-      !merge_map[row][target_col - 1]) {
-    target_col--;
-  }
-  return target_col;
-}
-
-static int CalculateTargetColRight(Board *board, Cell cell, int row, int col,
-                                   bool merge_map[BOARD_ROWS][BOARD_COLS]) {
-  int target_col = col;
-  for (; target_col < BOARD_COLS - 1; target_col++)
-    if (!IsCellEmpty(board->cells[row][target_col + 1]))
-      break;
-
-  if (target_col < BOARD_COLS - 1 &&
-      board->cells[row][target_col + 1] == cell &&
-      !merge_map[row][target_col + 1])
-    target_col++;
-  return target_col;
-}
-
-static int CalculateTargetRowUp(Board *board, Cell cell, int row, int col,
-                                bool merge_map[BOARD_ROWS][BOARD_COLS]) {
-  int target_row = row;
-  for (; target_row > 0; target_row--)
-    if (!IsCellEmpty(board->cells[target_row - 1][col]))
-      break;
-
-  if (target_row > 0 && board->cells[target_row - 1][col] == cell &&
-      !merge_map[target_row - 1][col])
-    target_row--;
-  return target_row;
-}
-
-static int CalculateTargetRowDown(Board *board, Cell cell, int row, int col,
-                                  bool merge_map[BOARD_ROWS][BOARD_COLS]) {
-  int target_row = row;
-  for (; target_row < BOARD_ROWS - 1; target_row++)
-    if (!IsCellEmpty(board->cells[target_row + 1][col]))
-      break;
-
-  if (target_row < BOARD_COLS - 1 &&
-      board->cells[target_row + 1][col] == cell &&
-      !merge_map[target_row + 1][col])
-    target_row++;
-  return target_row;
-}
-
-static void MoveLeft(Board *board) {
-  bool merge_map[BOARD_ROWS][BOARD_COLS] = {0};
-
+PackedBoard PackBoard(const Board *board) {
+  PackedBoard packed = 0;
   for (int row = 0; row < BOARD_ROWS; row++) {
     for (int col = 0; col < BOARD_COLS; col++) {
       Cell cell = board->cells[row][col];
-      if (IsCellEmpty(cell))
-        continue;
-
-      int target_col = CalculateTargetColLeft(board, cell, row, col, merge_map);
-      bool is_merge =
-          col != target_col && !IsCellEmpty(board->cells[row][target_col]);
-      Vector2 from_pos = GetCellPosition(row, col);
-      Vector2 to_pos = GetCellPosition(row, target_col);
-      AddMoveAnimation(&board->animation, cell, is_merge, from_pos, to_pos);
-      if (is_merge) {
-        AddMergeAnimation(&board->animation, cell * 2, to_pos);
-        merge_map[row][target_col] = true;
-      }
-      board->cells[row][col] = EMPTY_CELL;
-      board->cells[row][target_col] = is_merge ? cell * 2 : cell;
-    }
-  }
-}
-
-static void MoveRight(Board *board) {
-  bool merge_map[BOARD_ROWS][BOARD_COLS] = {0};
-
-  for (int row = 0; row < BOARD_ROWS; row++) {
-    for (int col = BOARD_COLS - 1; col >= 0; col--) {
-      Cell cell = board->cells[row][col];
-      if (IsCellEmpty(cell))
-        continue;
-
-      int target_col =
-          CalculateTargetColRight(board, cell, row, col, merge_map);
-      bool is_merge =
-          col != target_col && !IsCellEmpty(board->cells[row][target_col]);
-      Vector2 from_pos = GetCellPosition(row, col);
-      Vector2 to_pos = GetCellPosition(row, target_col);
-      AddMoveAnimation(&board->animation, cell, is_merge, from_pos, to_pos);
-      if (is_merge) {
-        AddMergeAnimation(&board->animation, cell * 2, to_pos);
-        merge_map[row][target_col] = true;
-      }
-      board->cells[row][col] = EMPTY_CELL;
-      board->cells[row][target_col] = is_merge ? cell * 2 : cell;
-    }
-  }
-}
-
-static void MoveUp(Board *board) {
-  bool merge_map[BOARD_ROWS][BOARD_COLS] = {0};
-
-  for (int row = 0; row < BOARD_ROWS; row++) {
-    for (int col = 0; col < BOARD_COLS; col++) {
-      Cell cell = board->cells[row][col];
-      if (IsCellEmpty(cell))
-        continue;
-
-      int target_row = CalculateTargetRowUp(board, cell, row, col, merge_map);
-      bool is_merge =
-          row != target_row && !IsCellEmpty(board->cells[target_row][col]);
-      Vector2 from_pos = GetCellPosition(row, col);
-      Vector2 to_pos = GetCellPosition(target_row, col);
-      AddMoveAnimation(&board->animation, cell, is_merge, from_pos, to_pos);
-      if (is_merge) {
-        AddMergeAnimation(&board->animation, cell * 2, to_pos);
-        merge_map[target_row][col] = true;
-      }
-      board->cells[row][col] = EMPTY_CELL;
-      board->cells[target_row][col] = is_merge ? cell * 2 : cell;
-    }
-  }
-}
-
-static void MoveDown(Board *board) {
-  bool merge_map[BOARD_ROWS][BOARD_COLS] = {0};
-
-  for (int row = BOARD_ROWS - 1; row >= 0; row--) {
-    for (int col = 0; col < BOARD_COLS; col++) {
-      Cell cell = board->cells[row][col];
-      if (IsCellEmpty(cell))
-        continue;
-
-      int target_row = CalculateTargetRowDown(board, cell, row, col, merge_map);
-      bool is_merge =
-          row != target_row && !IsCellEmpty(board->cells[target_row][col]);
-      Vector2 from_pos = GetCellPosition(row, col);
-      Vector2 to_pos = GetCellPosition(target_row, col);
-      AddMoveAnimation(&board->animation, cell, is_merge, from_pos, to_pos);
-      if (is_merge) {
-        AddMergeAnimation(&board->animation, cell * 2, to_pos);
-        merge_map[target_row][col] = true;
+      int exponent = 0;
+      while (cell > 1) {
+        cell >>= 1;
+        exponent++;
       }
-      board->cells[row][col] = EMPTY_CELL;
-      board->cells[target_row][col] = is_merge ? cell * 2 : cell;
+      packed |= (PackedBoard)exponent << (4 * (row * BOARD_COLS + col));
     }
   }
+  return packed;
 }
@@ -2,36 +2,36 @@
 #define BOARD_H
 
 #include "animation.h"
+#include "cells.h"
+#include "rules.h"
 #include <stdbool.h>
 
-#define EMPTY_CELL 0
 #define BOARD_WIDTH 800.0
 #define BOARD_HEIGHT 800.0
-#define BOARD_ROWS 4
-#define BOARD_COLS 4
 #define CELL_GAP_SIZE 22
 #define CELL_WIDTH                                                             \
   ((BOARD_WIDTH - (CELL_GAP_SIZE * (BOARD_COLS + 1))) / BOARD_COLS)
 #define CELL_HEIGHT                                                            \
   ((BOARD_HEIGHT - (CELL_GAP_SIZE * (BOARD_ROWS + 1))) / BOARD_ROWS)
 
-typedef struct {
-  int x;
-  int y;
-} Point;
-
 typedef enum { CELL_EMPTY, CELL_FULL } CellType;
 
-typedef int Cell;
-
 
 typedef struct {
   Cell cells[BOARD_ROWS][BOARD_COLS];
   Animation animation;
+  Score score;
+  // Moves only change cells. The animation of the last move is built from
+  // these and cells by the next UpdateBoard or DrawBoard.
+  Cell previous_cells[BOARD_ROWS][BOARD_COLS];
+  Direction previous_move;
+  bool animation_pending;
 } Board;
 
 void InitBoard(Board *board);
-void UpdateBoard(Board *board);
+bool UpdateBoard(Board *board);
+bool MoveBoard(Board *board, Direction dir);
+PackedBoard PackBoard(const Board *board);
 void DrawBoard(Board *board);
 
 #endif // BOARD_H
@@ -0,0 +1,193 @@
+#include "cells.h"
+#include <string.h>
+
+static bool IsCellEmpty(Cell cell) { return cell == 0; }
+
+static int CalculateTargetColLeft(Cell cells[BOARD_ROWS][BOARD_COLS], Cell cell,
+                                  int row, int col,
+                                  bool merge_map[BOARD_ROWS][BOARD_COLS]) {
+  int target_col = col;
+  for (; target_col > 0; target_col--)
+    if (!IsCellEmpty(cells[row][target_col - 1]))
+      break;
+
+  if (target_col > 0 && cells[row][target_col - 1] == cell &&
+      !merge_map[row][target_col - 1]) {
+    target_col--;
+  }
+  return target_col;
+}
+
+static int CalculateTargetColRight(Cell cells[BOARD_ROWS][BOARD_COLS],
+                                   Cell cell, int row, int col,
+                                   bool merge_map[BOARD_ROWS][BOARD_COLS]) {
+  int target_col = col;
+  for (; target_col < BOARD_COLS - 1; target_col++)
+    if (!IsCellEmpty(cells[row][target_col + 1]))
+      break;
+
+  if (target_col < BOARD_COLS - 1 && cells[row][target_col + 1] == cell &&
+      !merge_map[row][target_col + 1])
+    target_col++;
+  return target_col;
+}
+
+static int CalculateTargetRowUp(Cell cells[BOARD_ROWS][BOARD_COLS], Cell cell,
+                                int row, int col,
+                                bool merge_map[BOARD_ROWS][BOARD_COLS]) {
+  int target_row = row;
+  for (; target_row > 0; target_row--)
+    if (!IsCellEmpty(cells[target_row - 1][col]))
+      break;
+
+  if (target_row > 0 && cells[target_row - 1][col] == cell &&
+      !merge_map[target_row - 1][col])
+    target_row--;
+  return target_row;
+}
+
+static int CalculateTargetRowDown(Cell cells[BOARD_ROWS][BOARD_COLS], Cell cell,
+                                  int row, int col,
+                                  bool merge_map[BOARD_ROWS][BOARD_COLS]) {
+  int target_row = row;
+  for (; target_row < BOARD_ROWS - 1; target_row++)
+    if (!IsCellEmpty(cells[target_row + 1][col]))
+      break;
+
+  if (target_row < BOARD_COLS - 1 && cells[target_row + 1][col] == cell &&
+      !merge_map[target_row + 1][col])
+    target_row++;
+  return target_row;
+}
+
+static void MoveCell(Cell cells[BOARD_ROWS][BOARD_COLS], Cell cell, int row,
+                     int col, int target_row, int target_col,
+                     bool merge_map[BOARD_ROWS][BOARD_COLS], Score *score,
+                     CellSteps *steps) {
+  bool is_merge = (row != target_row || col != target_col) &&
+                  !IsCellEmpty(cells[target_row][target_col]);
+  if (steps != NULL) {
+    steps->moves[steps->move_count++] =
+        (CellMove){.number = cell,
+                   .is_merge = is_merge,
+                   .from = {.x = col, .y = row},
+                   .to = {.x = target_col, .y = target_row}};
+  }
+  if (is_merge) {
+    if (score != NULL) {
+      score->points += cell * 2;
+      score->merges++;
+    }
+    merge_map[target_row][target_col] = true;
+  }
+  cells[row][col] = EMPTY_CELL;
+  cells[target_row][target_col] = is_merge ? cell * 2 : cell;
+}
+
+static void MoveLeft(Cell cells[BOARD_ROWS][BOARD_COLS], Score *score,
+                     CellSteps *steps) {
+  bool merge_map[BOARD_ROWS][BOARD_COLS] = {0};
+
+  for (int row = 0; row < BOARD_ROWS; row++) {
+    for (int col = 0; col < BOARD_COLS; col++) {
+      Cell cell = cells[row][col];
+      if (IsCellEmpty(cell))
+        continue;
+
+      int target_col = CalculateTargetColLeft(cells, cell, row, col, merge_map);
+      MoveCell(cells, cell, row, col, row, target_col, merge_map, score,
+               steps);
+    }
+  }
+}
+
+static void MoveRight(Cell cells[BOARD_ROWS][BOARD_COLS], Score *score,
+                      CellSteps *steps) {
+  bool merge_map[BOARD_ROWS][BOARD_COLS] = {0};
+
+  for (int row = 0; row < BOARD_ROWS; row++) {
+    for (int col = BOARD_COLS - 1; col >= 0; col--) {
+      Cell cell = cells[row][col];
+      if (IsCellEmpty(cell))
+        continue;
+
+      int target_col =
+          CalculateTargetColRight(cells, cell, row, col, merge_map);
+      MoveCell(cells, cell, row, col, row, target_col, merge_map, score,
+               steps);
+    }
+  }
+}
+
+static void MoveUp(Cell cells[BOARD_ROWS][BOARD_COLS], Score *score,
+                   CellSteps *steps) {
+  bool merge_map[BOARD_ROWS][BOARD_COLS] = {0};
+
+  for (int row = 0; row < BOARD_ROWS; row++) {
+    for (int col = 0; col < BOARD_COLS; col++) {
+      Cell cell = cells[row][col];
+      if (IsCellEmpty(cell))
+        continue;
+
+      int target_row = CalculateTargetRowUp(cells, cell, row, col, merge_map);
+      MoveCell(cells, cell, row, col, target_row, col, merge_map, score,
+               steps);
+    }
+  }
+}
+
+static void MoveDown(Cell cells[BOARD_ROWS][BOARD_COLS], Score *score,
+                     CellSteps *steps) {
+  bool merge_map[BOARD_ROWS][BOARD_COLS] = {0};
+
+  for (int row = BOARD_ROWS - 1; row >= 0; row--) {
+    for (int col = 0; col < BOARD_COLS; col++) {
+      Cell cell = cells[row][col];
+      if (IsCellEmpty(cell))
+        continue;
+
+      int target_row = CalculateTargetRowDown(cells, cell, row, col, merge_map);
+      MoveCell(cells, cell, row, col, target_row, col, merge_map, score,
+               steps);
+    }
+  }
+}
+
+bool SlideCells(Cell cells[BOARD_ROWS][BOARD_COLS], Direction dir,
+                Score *score, CellSteps *steps) {
+  Cell before[BOARD_ROWS][BOARD_COLS];
+  memcpy(before, cells, sizeof(before));
+  switch (dir) {
+  case DIRECTION_LEFT:
+    MoveLeft(cells, score, steps);
+    break;
+  case DIRECTION_RIGHT:
+    MoveRight(cells, score, steps);
+    break;
+  case DIRECTION_UP:
+    MoveUp(cells, score, steps);
+    break;
+  case DIRECTION_DOWN:
+    MoveDown(cells, score, steps);
+    break;
+  case DIRECTION_COUNT:
+    break;
+  }
+  return memcmp(before, cells, sizeof(before)) != 0;
+}
+
+void DeriveCellSteps(Cell before[BOARD_ROWS][BOARD_COLS], Direction dir,
+                     Cell after[BOARD_ROWS][BOARD_COLS], CellSteps *steps) {
+  Cell cells[BOARD_ROWS][BOARD_COLS];
+  memcpy(cells, before, sizeof(cells));
+  steps->move_count = 0;
+  steps->appear_count = 0;
+  SlideCells(cells, dir, NULL, steps);
+  for (int row = 0; row < BOARD_ROWS; row++) {
+    for (int col = 0; col < BOARD_COLS; col++) {
+      if (IsCellEmpty(cells[row][col]) && !IsCellEmpty(after[row][col]))
+        steps->appears[steps->appear_count++] =
+            (CellAppear){.number = after[row][col], .in = {.x = col, .y = row}};
+    }
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef CELLS_H
+#define CELLS_H
+
+#include "rules.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Move rules of board.c on its grid of cells, apart from the drawing and the
+// Animation records so headless tools and the fuzzer can run them without
+// raylib.
+
+#define EMPTY_CELL 0
+#define BOARD_ROWS 4
+#define BOARD_COLS 4
+
+typedef struct {
+  int x;
+  int y;
+} Point;
+
+typedef int Cell;
+
+// One tile of the move, from == to when it stayed. A merge leaves a tile of
+// twice number at to.
+typedef struct {
+  Cell number;
+  bool is_merge;
+  Point from;
+  Point to;
+} CellMove;
+
+typedef struct {
+  Cell number;
+  Point in;
+} CellAppear;
+
+typedef struct {
+  CellMove moves[BOARD_ROWS * BOARD_COLS];
+  size_t move_count;
+  CellAppear appears[BOARD_ROWS * BOARD_COLS];
+  size_t appear_count;
+} CellSteps;
+
+// Slides every tile towards dir. Adds the points and merges of the move to
+// score and a CellMove per tile to steps, both may be NULL. Returns whether
+// the cells changed.
+bool SlideCells(Cell cells[BOARD_ROWS][BOARD_COLS], Direction dir,
+                Score *score, CellSteps *steps);
+
+// Steps of the turn that took before to after: dir is replayed on a copy of
+// before, every tile of after that the replay does not explain was spawned.
+void DeriveCellSteps(Cell before[BOARD_ROWS][BOARD_COLS], Direction dir,
+                     Cell after[BOARD_ROWS][BOARD_COLS], CellSteps *steps);
+
+#endif // CELLS_H
@@ -0,0 +1,229 @@
+#include "classic.h"
+#include <string.h>
+
+static bool IsCellEmpty(int tile) { return tile == 0; }
+
+static int CalculateTargetColLeft(int map[CLASSIC_ROWS][CLASSIC_COLS],
+                                  bool merge_map[CLASSIC_ROWS][CLASSIC_COLS],
+                                  int cell, int row, int col) {
+  int target_col = col;
+  for (; target_col > 0; target_col--)
+    if (!IsCellEmpty(map[row][target_col - 1]))
+      break;
+
+  if (target_col > 0 && map[row][target_col - 1] == cell &&
+      !merge_map[row][target_col - 1]) {
+    target_col--;
+  }
+  return target_col;
+}
+
+static int CalculateTargetColRight(int map[CLASSIC_ROWS][CLASSIC_COLS],
+                                   bool merge_map[CLASSIC_ROWS][CLASSIC_COLS],
+                                   int cell, int row, int col) {
+  int target_col = col;
+  for (; target_col < CLASSIC_COLS - 1; target_col++)
+    if (!IsCellEmpty(map[row][target_col + 1]))
+      break;
+
+  if (target_col < CLASSIC_COLS - 1 && map[row][target_col + 1] == cell &&
+      !merge_map[row][target_col + 1])
+    target_col++;
+  return target_col;
+}
+
+static int CalculateTargetRowUp(int map[CLASSIC_ROWS][CLASSIC_COLS],
+                                bool merge_map[CLASSIC_ROWS][CLASSIC_COLS],
+                                int cell, int row, int col) {
+  int target_row = row;
+  for (; target_row > 0; target_row--)
+    if (!IsCellEmpty(map[target_row - 1][col]))
+      break;
+
+  if (target_row > 0 && map[target_row - 1][col] == cell &&
+      !merge_map[target_row - 1][col])
+    target_row--;
+  return target_row;
+}
+
+static int CalculateTargetRowDown(int map[CLASSIC_ROWS][CLASSIC_COLS],
+                                  bool merge_map[CLASSIC_ROWS][CLASSIC_COLS],
+                                  int cell, int row, int col) {
+  int target_row = row;
+  for (; target_row < CLASSIC_ROWS - 1; target_row++)
+    if (!IsCellEmpty(map[target_row + 1][col]))
+      break;
+
+  if (target_row < CLASSIC_COLS - 1 && map[target_row + 1][col] == cell &&
+      !merge_map[target_row + 1][col])
+    target_row++;
+  return target_row;
+}
+
+static void MoveTile(int map[CLASSIC_ROWS][CLASSIC_COLS],
+                     bool merge_map[CLASSIC_ROWS][CLASSIC_COLS], Score *score,
+                     TileSteps *steps, int cell, int row, int col,
+                     int target_row, int target_col) {
+  bool is_idle = col == target_col && row == target_row;
+  bool is_merge = !is_idle && !IsCellEmpty(map[target_row][target_col]);
+
+  if (steps != NULL) {
+    steps->items[steps->count++] = (TileStep){
+        .type = is_idle ? TILE_IDLE : is_merge ? TILE_MERGE : TILE_MOVE,
+        .number = cell,
+        .new_number = is_merge ? cell * 2 : cell,
+        .from = {.row = row, .col = col},
+        .to = {.row = target_row, .col = target_col}};
+  }
+  if (is_merge && score != NULL) {
+    score->points += cell * 2;
+    score->merges++;
+  }
+  if (is_idle)
+    return;
+
+  map[row][col] = 0;
+  map[target_row][target_col] = is_merge ? cell * 2 : cell;
+  if (is_merge)
+    merge_map[target_row][target_col] = true;
+}
+
+static void MoveLeft(int map[CLASSIC_ROWS][CLASSIC_COLS], Score *score,
+                     TileSteps *steps) {
+  bool merge_map[CLASSIC_ROWS][CLASSIC_COLS] = {0};
+  for (int row = 0; row < CLASSIC_ROWS; row++) {
+    for (int col = 0; col < CLASSIC_COLS; col++) {
+      int cell = map[row][col];
+      if (IsCellEmpty(cell))
+        continue;
+
+      int target_col = CalculateTargetColLeft(map, merge_map, cell, row, col);
+      MoveTile(map, merge_map, score, steps, cell, row, col, row, target_col);
+    }
+  }
+}
+
+static void MoveRight(int map[CLASSIC_ROWS][CLASSIC_COLS], Score *score,
+                      TileSteps *steps) {
+  bool merge_map[CLASSIC_ROWS][CLASSIC_COLS] = {0};
+  for (int row = 0; row < CLASSIC_ROWS; row++) {
+    for (int col = CLASSIC_COLS - 1; col >= 0; col--) {
+      int cell = map[row][col];
+      if (IsCellEmpty(cell))
+        continue;
+
+      int target_col = CalculateTargetColRight(map, merge_map, cell, row, col);
+      MoveTile(map, merge_map, score, steps, cell, row, col, row, target_col);
+    }
+  }
+}
+
+static void MoveUp(int map[CLASSIC_ROWS][CLASSIC_COLS], Score *score,
+                   TileSteps *steps) {
+  bool merge_map[CLASSIC_ROWS][CLASSIC_COLS] = {0};
+  for (int row = 0; row < CLASSIC_ROWS; row++) {
+    for (int col = 0; col < CLASSIC_COLS; col++) {
+      int cell = map[row][col];
+      if (IsCellEmpty(cell))
+        continue;
+
+      int target_row = CalculateTargetRowUp(map, merge_map, cell, row, col);
+      MoveTile(map, merge_map, score, steps, cell, row, col, target_row, col);
+    }
+  }
+}
+
+static void MoveDown(int map[CLASSIC_ROWS][CLASSIC_COLS], Score *score,
+                     TileSteps *steps) {
+  bool merge_map[CLASSIC_ROWS][CLASSIC_COLS] = {0};
+  for (int row = CLASSIC_ROWS - 1; row >= 0; row--) {
+    for (int col = 0; col < CLASSIC_COLS; col++) {
+      int cell = map[row][col];
+      if (IsCellEmpty(cell))
+        continue;
+
+      int target_row = CalculateTargetRowDown(map, merge_map, cell, row, col);
+      MoveTile(map, merge_map, score, steps, cell, row, col, target_row, col);
+    }
+  }
+}
+
+bool SlideTileMap(int map[CLASSIC_ROWS][CLASSIC_COLS], MoveDirection dir,
+                  Score *score, TileSteps *steps) {
+  int before[CLASSIC_ROWS][CLASSIC_COLS];
+  memcpy(before, map, sizeof(before));
+  switch (dir) {
+  case MOVE_LEFT:
+    MoveLeft(map, score, steps);
+    break;
+  case MOVE_RIGHT:
+    MoveRight(map, score, steps);
+    break;
+  case MOVE_UP:
+    MoveUp(map, score, steps);
+    break;
+  case MOVE_DOWN:
+    MoveDown(map, score, steps);
+    break;
+  case MOVE_COUNT:
+    break;
+  }
+  return memcmp(before, map, sizeof(before)) != 0;
+}
+
+void DeriveTileSteps(int before[CLASSIC_ROWS][CLASSIC_COLS], MoveDirection dir,
+                     int after[CLASSIC_ROWS][CLASSIC_COLS], TileSteps *steps) {
+  int map[CLASSIC_ROWS][CLASSIC_COLS];
+  memcpy(map, before, sizeof(map));
+  steps->count = 0;
+  if (dir == MOVE_COUNT) {
+    for (int row = 0; row < CLASSIC_ROWS; row++) {
+      for (int col = 0; col < CLASSIC_COLS; col++) {
+        if (!IsCellEmpty(map[row][col]))
+          steps->items[steps->count++] =
+              (TileStep){.type = TILE_IDLE,
+                         .number = map[row][col],
+                         .new_number = map[row][col],
+                         .from = {.row = row, .col = col},
+                         .to = {.row = row, .col = col}};
+      }
+    }
+  } else {
+    SlideTileMap(map, dir, NULL, steps);
+  }
+
+  for (int row = 0; row < CLASSIC_ROWS; row++) {
+    for (int col = 0; col < CLASSIC_COLS; col++) {
+      if (!IsCellEmpty(map[row][col]) || IsCellEmpty(after[row][col]))
+        continue;
+      steps->items[steps->count++] =
+          (TileStep){.type = TILE_APPEAR,
+                     .number = after[row][col],
+                     .new_number = after[row][col],
+                     .from = {.row = row, .col = col},
+                     .to = {.row = row, .col = col}};
+    }
+  }
+}
+
+bool IsTileMapLost(int map[CLASSIC_ROWS][CLASSIC_COLS]) {
+  int prev_value = -1;
+  for (int row = 0; row < CLASSIC_ROWS; row++) {
+    for (int col = 0; col < CLASSIC_COLS; col++) {
+      if (IsCellEmpty(map[row][col]) || map[row][col] == prev_value) {
+        return false;
+      }
+      prev_value = map[row][col];
+    }
+  }
+  prev_value = -1;
+  for (int col = 0; col < CLASSIC_COLS; col++) {
+    for (int row = 0; row < CLASSIC_ROWS; row++) {
+      if (map[row][col] == prev_value) {
+        return false;
+      }
+      prev_value = map[row][col];
+    }
+  }
+  return true;
+}
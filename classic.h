@@ -0,0 +1,65 @@
+#ifndef CLASSIC_H
+#define CLASSIC_H
+
+#include "rules.h"
+#include <stdbool.h>
+
+// Move rules of 2048.c on its map of tile values, 0 for an empty cell. Nothing
+// in here draws, so the fuzzer runs the very code 2048.c plays with.
+
+#define CLASSIC_ROWS 4
+#define CLASSIC_COLS 4
+#define CLASSIC_CELLS (CLASSIC_ROWS * CLASSIC_COLS)
+// One step per tile before the turn plus the spawns, which can only land where
+// a merge or the move freed a cell.
+#define CLASSIC_MAX_STEPS (CLASSIC_CELLS + CLASSIC_CELLS / 2)
+
+typedef struct {
+  int row;
+  int col;
+} BoardPosition;
+
+typedef enum {
+  MOVE_LEFT,
+  MOVE_RIGHT,
+  MOVE_UP,
+  MOVE_DOWN,
+  MOVE_COUNT,
+} MoveDirection;
+
+typedef enum {
+  TILE_IDLE,
+  TILE_MOVE,
+  TILE_MERGE,
+  TILE_APPEAR,
+} TileType;
+
+// What one tile did in a turn. Idle and appearing tiles have from == to.
+typedef struct {
+  TileType type;
+  int number;
+  int new_number;
+  BoardPosition from;
+  BoardPosition to;
+} TileStep;
+
+typedef struct {
+  TileStep items[CLASSIC_MAX_STEPS];
+  int count;
+} TileSteps;
+
+// Slides every tile towards dir. Adds the points and merges of the move to
+// score and one step per tile to steps, both may be NULL. Returns whether the
+// map changed.
+bool SlideTileMap(int map[CLASSIC_ROWS][CLASSIC_COLS], MoveDirection dir,
+                  Score *score, TileSteps *steps);
+
+// Steps of the turn that took before to after: dir is replayed on a copy of
+// before, every tile of after that the replay does not explain was spawned.
+// MOVE_COUNT stands for no move, every tile of before stays where it is.
+void DeriveTileSteps(int before[CLASSIC_ROWS][CLASSIC_COLS], MoveDirection dir,
+                     int after[CLASSIC_ROWS][CLASSIC_COLS], TileSteps *steps);
+
+bool IsTileMapLost(int map[CLASSIC_ROWS][CLASSIC_COLS]);
+
+#endif // CLASSIC_H
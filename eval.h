@@ -0,0 +1,33 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "rules.h"
+
+// Position score for search on 4x4 boards. Every heuristic term only looks at
+// one line of four cells, so InitEvaluator scores all 65536 possible rows once
+// and a board is the sum of its four rows plus the four rows of its transpose.
+
+typedef struct {
+  float empty;        // per empty cell
+  float merges;       // per pair of equal neighbours
+  float monotonicity; // penalty for lines that go up and down
+  float monotonicity_power;
+  float smoothness; // penalty per step between neighbouring exponents
+  float sum;        // penalty for large tiles outside of merges
+  float sum_power;
+} EvalWeights;
+
+typedef struct {
+  EvalWeights weights;
+  float rows[1 << 16];
+} Evaluator;
+
+EvalWeights GetDefaultEvalWeights(void);
+
+// Evaluator is 256 KiB, keep it static or on the heap.
+void InitEvaluator(Evaluator *evaluator, EvalWeights weights);
+
+float EvaluateRow(const EvalWeights *weights, PackedRow row);
+float EvaluateBoard(const Evaluator *evaluator, PackedBoard board);
+
+#endif // EVAL_H
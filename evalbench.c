@@ -0,0 +1,192 @@
+#define _POSIX_C_SOURCE 200809L
+#include "eval.h"
+#include "policy.h"
+#include "rules.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Measures EvaluateBoard on positions taken from greedy games, next to the
+// same heuristic computed by walking the grid cell by cell, and checks that
+// both agree.
+
+#define DEFAULT_POSITIONS (1 << 20)
+#define DEFAULT_ROUNDS 64
+
+static Rules rules;
+static Evaluator evaluator;
+
+static double GetSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// The heuristic from its description in eval.h, walking the eight lines of
+// the grid in place. Shares no code with eval.c, so a mistake in EvaluateRow
+// or in the table lookups can not cancel out.
+static float EvaluateLineDirect(const EvalWeights *weights,
+                                int grid[RULES_MAX_SIZE][RULES_MAX_SIZE],
+                                int row, int col, int row_step, int col_step) {
+  int line[RULES_MAX_SIZE];
+  for (int i = 0; i < RULES_MAX_SIZE; i++) {
+    line[i] = grid[row + i * row_step][col + i * col_step];
+  }
+
+  int empty = 0;
+  float sum = 0;
+  int tiles[RULES_MAX_SIZE];
+  int tile_count = 0;
+  for (int i = 0; i < RULES_MAX_SIZE; i++) {
+    if (line[i] == 0) {
+      empty++;
+      continue;
+    }
+    sum += powf(line[i], weights->sum_power);
+    tiles[tile_count++] = line[i];
+  }
+
+  // Every tile in a group of equal neighbours, gaps ignored, counts once.
+  int merges = 0;
+  for (int i = 0; i < tile_count; i++) {
+    bool same_as_previous = i > 0 && tiles[i - 1] == tiles[i];
+    bool same_as_next = i + 1 < tile_count && tiles[i + 1] == tiles[i];
+    if (same_as_previous || same_as_next)
+      merges++;
+  }
+
+  float falling = 0;
+  float rising = 0;
+  int smoothness = 0;
+  for (int i = 0; i + 1 < RULES_MAX_SIZE; i++) {
+    float step = powf(line[i + 1], weights->monotonicity_power) -
+                 powf(line[i], weights->monotonicity_power);
+    if (line[i] > line[i + 1])
+      falling -= step;
+    else
+      rising += step;
+    if (line[i] != 0 && line[i + 1] != 0)
+      smoothness += line[i] > line[i + 1] ? line[i] - line[i + 1]
+                                          : line[i + 1] - line[i];
+  }
+
+  return weights->empty * empty + weights->merges * merges -
+         weights->monotonicity * (falling < rising ? falling : rising) -
+         weights->smoothness * smoothness - weights->sum * sum;
+}
+
+static float EvaluateBoardDirect(const EvalWeights *weights,
+                                 PackedBoard board) {
+  int grid[RULES_MAX_SIZE][RULES_MAX_SIZE];
+  for (int row = 0; row < RULES_MAX_SIZE; row++) {
+    for (int col = 0; col < RULES_MAX_SIZE; col++) {
+      grid[row][col] = GetPackedCell(&rules, board, row, col);
+    }
+  }
+
+  float score = 0;
+  for (int i = 0; i < RULES_MAX_SIZE; i++) {
+    score += EvaluateLineDirect(weights, grid, i, 0, 0, 1);
+    score += EvaluateLineDirect(weights, grid, 0, i, 1, 0);
+  }
+  return score;
+}
+
+static void CollectPositions(PackedBoard *positions, int count, uint64_t seed) {
+  Policy policy;
+  ParsePolicy(&policy, "greedy");
+  uint64_t rng = SeedRandom(seed);
+  PackedBoard board = NewPackedGame(&rules, &rng);
+  int move_index = 0;
+  for (int i = 0; i < count; i++) {
+    positions[i] = board;
+    Direction dir =
+        ChoosePolicyMove(&policy, &rules, board, &rng, move_index++);
+    if (dir == DIRECTION_COUNT) {
+      board = NewPackedGame(&rules, &rng);
+      move_index = 0;
+      continue;
+    }
+    board = SpawnRandom(&rules, MovePacked(&rules, board, dir), &rng);
+  }
+}
+
+static void Usage(const char *program) {
+  fprintf(stderr, "Usage: %s [-n positions] [-r rounds] [-s seed]\n",
+          program);
+}
+
+int main(int argc, char **argv) {
+  int position_count = DEFAULT_POSITIONS;
+  int rounds = DEFAULT_ROUNDS;
+  uint64_t seed = 1;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+      return 1;
+    }
+    if (strcmp(argv[i], "-n") == 0) {
+      position_count = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-r") == 0) {
+      rounds = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (position_count < 1 || rounds < 1) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  InitRules(&rules, RULES_MAX_SIZE);
+  double start = GetSeconds();
+  InitEvaluator(&evaluator, GetDefaultEvalWeights());
+  printf("tables:  %.1f ms\n", (GetSeconds() - start) * 1000);
+
+  PackedBoard *positions = malloc(position_count * sizeof(PackedBoard));
+  assert(positions != NULL && "Buy more RAM lol");
+  CollectPositions(positions, position_count, seed);
+
+  for (int i = 0; i < position_count; i++) {
+    float table = EvaluateBoard(&evaluator, positions[i]);
+    float direct = EvaluateBoardDirect(&evaluator.weights, positions[i]);
+    if (fabsf(table - direct) > 1e-3f * fmaxf(1, fabsf(direct))) {
+      fprintf(stderr, "ERROR: %016llx evaluates to %f, expected %f\n",
+              (unsigned long long)positions[i], table, direct);
+      return 1;
+    }
+  }
+
+  // The sums keep the compiler from dropping the loops.
+  float sink = 0;
+  start = GetSeconds();
+  for (int round = 0; round < rounds; round++) {
+    for (int i = 0; i < position_count; i++) {
+      sink += EvaluateBoard(&evaluator, positions[i]);
+    }
+  }
+  double table_seconds = GetSeconds() - start;
+
+  start = GetSeconds();
+  for (int i = 0; i < position_count; i++) {
+    sink += EvaluateBoardDirect(&evaluator.weights, positions[i]);
+  }
+  double direct_seconds = GetSeconds() - start;
+
+  double table_rate = (double)rounds * position_count / table_seconds;
+  double direct_rate = position_count / direct_seconds;
+  printf("table:   %.2f M evaluations/s\n", table_rate / 1e6);
+  printf("direct:  %.2f M evaluations/s\n", direct_rate / 1e6);
+  printf("speedup: %.1fx (checksum %g)\n", table_rate / direct_rate, sink);
+
+  free(positions);
+  return 0;
+}
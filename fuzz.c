@@ -0,0 +1,543 @@
+#define _DEFAULT_SOURCE
+#include "cells.h"
+#include "classic.h"
+#include "rules.h"
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Differential fuzzer for the move engines. rules.c is the reference, the
+// engine of 2048.c in classic.c and the engine of board.c in cells.c are
+// checked against it on every direction of every position, along with the
+// game over test of 2048.c. Positions come from random games, from uniform
+// random boards and from boards built out of two or three neighbouring values,
+// which is where merge order and game over bugs live.
+//
+// Workers are forked processes rather than threads, so an engine that crashes
+// only takes its worker down. Each one keeps the first failure of every
+// check, shrinks it to the smallest board that still fails, and leaves it in
+// a shared mapping for the parent to print.
+//
+// Spawning is not compared: 2048.c, board.c and rules.c each draw from their
+// own RNG on purpose.
+//
+// Two divergences are known and left alone, so they are counted apart and do
+// not fail the run unless -a is given. IsTileMapLost carries the previous
+// value from the end of one line to the start of the next, so two equal tiles
+// at the ends of neighbouring lines look mergeable; an answer that a model of
+// exactly that bug also gives is known. And 2^15 tiles do not merge in rules.c
+// but do in the other engines; a move that made a 2^16 tile is known. Any
+// other divergence still fails, so a plain run works as a regression gate.
+
+#define MAX_WORKERS 64
+#define PROGRESS_BATCH 4096
+
+_Static_assert(CLASSIC_CELLS == RULES_MAX_CELLS &&
+                   BOARD_ROWS * BOARD_COLS == RULES_MAX_CELLS,
+               "engine boards do not match rules.h");
+
+// What one move engine did to a 4x4 board. Cells hold tile values (2, 4, ...)
+// row-major, 0 for empty, so engines that do not cap tiles at
+// RULES_MAX_EXPONENT can still report what they produced.
+typedef struct {
+  int cells[RULES_MAX_CELLS];
+  uint64_t points;
+  uint64_t merges;
+  bool moved;
+} EngineResult;
+
+typedef enum {
+  CHECK_CLASSIC_MOVE,
+  CHECK_BOARD_MOVE,
+  CHECK_CLASSIC_LOST,
+  CHECK_COUNT,
+} Check;
+
+static const char *check_names[CHECK_COUNT] = {
+    [CHECK_CLASSIC_MOVE] = "2048.c move",
+    [CHECK_BOARD_MOVE] = "board.c move",
+    [CHECK_CLASSIC_LOST] = "2048.c IsTileMapLost",
+};
+
+typedef enum {
+  SOURCE_GAME,
+  SOURCE_RANDOM,
+  SOURCE_ADVERSARIAL,
+  SOURCE_COUNT,
+} Source;
+
+typedef struct {
+  bool found;
+  PackedBoard board;
+  Direction direction;
+} Counterexample;
+
+typedef struct {
+  atomic_uint_fast64_t positions;
+  uint64_t failures[CHECK_COUNT];
+  uint64_t known[CHECK_COUNT];
+  Counterexample counterexamples[CHECK_COUNT];
+} WorkerReport;
+
+typedef struct {
+  uint64_t rng;
+  PackedBoard game;
+  int max_exponent;
+} Generator;
+
+static const char *direction_names[DIRECTION_COUNT] = {
+    [DIRECTION_LEFT] = "left",
+    [DIRECTION_RIGHT] = "right",
+    [DIRECTION_UP] = "up",
+    [DIRECTION_DOWN] = "down",
+};
+
+static const MoveDirection classic_moves[DIRECTION_COUNT] = {
+    [DIRECTION_LEFT] = MOVE_LEFT,
+    [DIRECTION_RIGHT] = MOVE_RIGHT,
+    [DIRECTION_UP] = MOVE_UP,
+    [DIRECTION_DOWN] = MOVE_DOWN,
+};
+
+static Rules rules;
+static bool fail_known;
+
+static int GetCell(PackedBoard board, int cell) {
+  return (board >> (4 * cell)) & 0xF;
+}
+
+static PackedBoard SetCell(PackedBoard board, int cell, int exponent) {
+  board &= ~((PackedBoard)0xF << (4 * cell));
+  return board | (PackedBoard)exponent << (4 * cell);
+}
+
+static void UnpackCells(PackedBoard board, int cells[RULES_MAX_CELLS]) {
+  for (int cell = 0; cell < RULES_MAX_CELLS; cell++) {
+    int exponent = GetCell(board, cell);
+    cells[cell] = exponent == 0 ? 0 : 1 << exponent;
+  }
+}
+
+static void MoveReference(PackedBoard board, Direction dir,
+                          EngineResult *result) {
+  Score score = {0};
+  PackedBoard moved = MoveScored(&rules, board, dir, &score);
+  UnpackCells(moved, result->cells);
+  result->points = score.points;
+  result->merges = score.merges;
+  result->moved = moved != board;
+}
+
+static void MoveClassic(const int cells[RULES_MAX_CELLS], Direction dir,
+                        EngineResult *result) {
+  int map[CLASSIC_ROWS][CLASSIC_COLS];
+  memcpy(map, cells, sizeof(map));
+  Score score = {0};
+  result->moved = SlideTileMap(map, classic_moves[dir], &score, NULL);
+  memcpy(result->cells, map, sizeof(result->cells));
+  result->points = score.points;
+  result->merges = score.merges;
+}
+
+static bool IsClassicGameLost(const int cells[RULES_MAX_CELLS]) {
+  int map[CLASSIC_ROWS][CLASSIC_COLS];
+  memcpy(map, cells, sizeof(map));
+  return IsTileMapLost(map);
+}
+
+static void MoveBoardEngine(const int cells[RULES_MAX_CELLS], Direction dir,
+                            EngineResult *result) {
+  Cell board[BOARD_ROWS][BOARD_COLS];
+  memcpy(board, cells, sizeof(board));
+  Score score = {0};
+  result->moved = SlideCells(board, dir, &score, NULL);
+  memcpy(result->cells, board, sizeof(result->cells));
+  result->points = score.points;
+  result->merges = score.merges;
+}
+
+// The known bug of IsTileMapLost on its own: a lost board has no empty cell
+// and no equal neighbours, but the previous value is only reset once before
+// the rows and once before the columns. Merges are not capped either.
+static bool IsLostCarryingPrevious(const int cells[RULES_MAX_CELLS]) {
+  int by_row = -1, by_col = -1;
+  for (int i = 0; i < RULES_MAX_SIZE; i++) {
+    for (int j = 0; j < RULES_MAX_SIZE; j++) {
+      int cell = cells[i * RULES_MAX_SIZE + j];
+      if (cell == 0 || cell == by_row)
+        return false;
+      by_row = cell;
+    }
+  }
+  for (int j = 0; j < RULES_MAX_SIZE; j++) {
+    for (int i = 0; i < RULES_MAX_SIZE; i++) {
+      int cell = cells[i * RULES_MAX_SIZE + j];
+      if (cell == by_col)
+        return false;
+      by_col = cell;
+    }
+  }
+  return true;
+}
+
+static bool HasUncappedTile(const EngineResult *result) {
+  for (int cell = 0; cell < RULES_MAX_CELLS; cell++) {
+    if (result->cells[cell] > 1 << RULES_MAX_EXPONENT)
+      return true;
+  }
+  return false;
+}
+
+// Whether a divergence is one of the two described at the top of the file.
+static bool IsKnownDivergence(Check check, const int cells[RULES_MAX_CELLS],
+                              const EngineResult *actual) {
+  if (fail_known)
+    return false;
+  switch (check) {
+  case CHECK_CLASSIC_MOVE:
+  case CHECK_BOARD_MOVE:
+    return HasUncappedTile(actual);
+  case CHECK_CLASSIC_LOST:
+    return IsClassicGameLost(cells) == IsLostCarryingPrevious(cells);
+  case CHECK_COUNT:
+    break;
+  }
+  return false;
+}
+
+static bool ResultsMatch(const EngineResult *a, const EngineResult *b) {
+  return memcmp(a->cells, b->cells, sizeof(a->cells)) == 0 &&
+         a->points == b->points && a->merges == b->merges &&
+         a->moved == b->moved;
+}
+
+static void RunEngine(Check check, const int cells[RULES_MAX_CELLS],
+                      Direction dir, EngineResult *result) {
+  switch (check) {
+  case CHECK_CLASSIC_MOVE:
+    MoveClassic(cells, dir, result);
+    break;
+  case CHECK_BOARD_MOVE:
+    MoveBoardEngine(cells, dir, result);
+    break;
+  case CHECK_CLASSIC_LOST:
+  case CHECK_COUNT:
+    break;
+  }
+}
+
+// Known divergences do not count, so shrinking never ends up on one.
+static bool Diverges(Check check, PackedBoard board, Direction dir) {
+  int cells[RULES_MAX_CELLS];
+  UnpackCells(board, cells);
+  if (check == CHECK_CLASSIC_LOST)
+    return IsClassicGameLost(cells) == CanMovePacked(&rules, board) &&
+           !IsKnownDivergence(check, cells, NULL);
+
+  EngineResult expected, actual;
+  MoveReference(board, dir, &expected);
+  RunEngine(check, cells, dir, &actual);
+  return !ResultsMatch(&expected, &actual) &&
+         !IsKnownDivergence(check, cells, &actual);
+}
+
+// Drops tiles or lowers them one cell at a time for as long as the check keeps
+// failing. Every step lowers the tile sum, so this always ends.
+static PackedBoard Shrink(Check check, PackedBoard board, Direction dir) {
+  bool shrunk = true;
+  while (shrunk) {
+    shrunk = false;
+    for (int cell = 0; cell < RULES_MAX_CELLS; cell++) {
+      int exponent = GetCell(board, cell);
+      for (int smaller = 0; smaller < exponent; smaller++) {
+        PackedBoard candidate = SetCell(board, cell, smaller);
+        if (Diverges(check, candidate, dir)) {
+          board = candidate;
+          shrunk = true;
+          break;
+        }
+      }
+    }
+  }
+  return board;
+}
+
+static void RecordFailure(WorkerReport *report, Check check, PackedBoard board,
+                          Direction dir) {
+  report->failures[check]++;
+  if (report->counterexamples[check].found)
+    return;
+  report->counterexamples[check] = (Counterexample){
+      .found = true, .board = Shrink(check, board, dir), .direction = dir};
+}
+
+static void CheckPosition(WorkerReport *report, PackedBoard board) {
+  int cells[RULES_MAX_CELLS];
+  UnpackCells(board, cells);
+  for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+    EngineResult expected;
+    MoveReference(board, dir, &expected);
+    for (Check check = CHECK_CLASSIC_MOVE; check <= CHECK_BOARD_MOVE;
+         check++) {
+      EngineResult actual;
+      RunEngine(check, cells, dir, &actual);
+      if (ResultsMatch(&expected, &actual))
+        continue;
+      if (IsKnownDivergence(check, cells, &actual))
+        report->known[check]++;
+      else
+        RecordFailure(report, check, board, dir);
+    }
+  }
+  if (IsClassicGameLost(cells) != CanMovePacked(&rules, board))
+    return;
+  if (IsKnownDivergence(CHECK_CLASSIC_LOST, cells, NULL))
+    report->known[CHECK_CLASSIC_LOST]++;
+  else
+    RecordFailure(report, CHECK_CLASSIC_LOST, board, DIRECTION_COUNT);
+}
+
+static PackedBoard NextPosition(Generator *generator, uint64_t index) {
+  uint64_t *rng = &generator->rng;
+  PackedBoard board = 0;
+  switch ((Source)(index % SOURCE_COUNT)) {
+  case SOURCE_GAME: {
+    board = generator->game;
+    int legal_moves = GetLegalMoves(&rules, board);
+    if (legal_moves == 0) {
+      generator->game = NewPackedGame(&rules, rng);
+      break;
+    }
+    Direction dir;
+    do {
+      dir = NextRandom(rng) % DIRECTION_COUNT;
+    } while ((legal_moves & (1 << dir)) == 0);
+    generator->game = SpawnRandom(&rules, MovePacked(&rules, board, dir), rng);
+  } break;
+  case SOURCE_RANDOM:
+    for (int cell = 0; cell < RULES_MAX_CELLS; cell++) {
+      int exponent = NextRandom(rng) % (generator->max_exponent + 1);
+      board = SetCell(board, cell, exponent);
+    }
+    break;
+  case SOURCE_ADVERSARIAL: {
+    int base = 1 + NextRandom(rng) % generator->max_exponent;
+    int values[3] = {0, base,
+                     base < generator->max_exponent ? base + 1 : base - 1};
+    // Full boards half of the time, to reach the game over test.
+    int first = NextRandom(rng) % 2;
+    for (int cell = 0; cell < RULES_MAX_CELLS; cell++) {
+      int value = values[first + NextRandom(rng) % (3 - first)];
+      board = SetCell(board, cell, value);
+    }
+  } break;
+  case SOURCE_COUNT:
+    break;
+  }
+  return board;
+}
+
+static void RunWorker(WorkerReport *report, uint64_t positions, uint64_t seed,
+                      int max_exponent) {
+  Generator generator = {.rng = seed, .max_exponent = max_exponent};
+  generator.game = NewPackedGame(&rules, &generator.rng);
+  for (uint64_t i = 0; i < positions; i++) {
+    CheckPosition(report, NextPosition(&generator, i));
+    if ((i + 1) % PROGRESS_BATCH == 0)
+      atomic_store(&report->positions, i + 1);
+  }
+  atomic_store(&report->positions, positions);
+}
+
+static int CountTiles(PackedBoard board) {
+  return RULES_MAX_CELLS - CountEmptyCells(&rules, board);
+}
+
+static void PrintRow(const int cells[RULES_MAX_CELLS], int row) {
+  for (int col = 0; col < RULES_MAX_SIZE; col++) {
+    printf("%6d", cells[row * RULES_MAX_SIZE + col]);
+  }
+}
+
+static void PrintCounterexample(Check check, const Counterexample *example) {
+  int cells[RULES_MAX_CELLS];
+  UnpackCells(example->board, cells);
+  if (check == CHECK_CLASSIC_LOST) {
+    printf("  board (2048.c says %s, rules.c says %s)\n",
+           IsClassicGameLost(cells) ? "lost" : "not lost",
+           CanMovePacked(&rules, example->board) ? "not lost" : "lost");
+    for (int row = 0; row < RULES_MAX_SIZE; row++) {
+      printf("  ");
+      PrintRow(cells, row);
+      printf("\n");
+    }
+    return;
+  }
+
+  EngineResult expected, actual;
+  MoveReference(example->board, example->direction, &expected);
+  RunEngine(check, cells, example->direction, &actual);
+  printf("  move %s\n", direction_names[example->direction]);
+  printf("  %-24s  %-24s  %s\n", "board", "rules.c",
+         check == CHECK_CLASSIC_MOVE ? "2048.c" : "board.c");
+  for (int row = 0; row < RULES_MAX_SIZE; row++) {
+    printf("  ");
+    PrintRow(cells, row);
+    printf("  ");
+    PrintRow(expected.cells, row);
+    printf("  ");
+    PrintRow(actual.cells, row);
+    printf("\n");
+  }
+  printf("  %-24s  %-24" PRIu64 "  %" PRIu64 "\n", "points", expected.points,
+         actual.points);
+  printf("  %-24s  %-24" PRIu64 "  %" PRIu64 "\n", "merges", expected.merges,
+         actual.merges);
+  printf("  %-24s  %-24s  %s\n", "moved", expected.moved ? "yes" : "no",
+         actual.moved ? "yes" : "no");
+}
+
+static double GetSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void Usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [-n positions] [-j workers] [-s seed] "
+          "[-m max exponent] [-a]\n",
+          program);
+  fprintf(stderr, "  -m exponent  largest generated tile, 1 to %d (default "
+                  "%d)\n",
+          RULES_MAX_EXPONENT, RULES_MAX_EXPONENT - 1);
+  fprintf(stderr, "  -a           fail on the known divergences too\n");
+}
+
+int main(int argc, char **argv) {
+  uint64_t positions_total = 10000000;
+  int worker_count = sysconf(_SC_NPROCESSORS_ONLN);
+  uint64_t seed = time(NULL);
+  // 2^15 tiles do not merge in rules.c but do in the other engines, leave
+  // them out unless asked for.
+  int max_exponent = RULES_MAX_EXPONENT - 1;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-a") == 0) {
+      fail_known = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+      return 1;
+    }
+    if (strcmp(argv[i], "-n") == 0) {
+      positions_total = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-j") == 0) {
+      worker_count = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-m") == 0) {
+      max_exponent = atoi(argv[++i]);
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (max_exponent < 1 || max_exponent > RULES_MAX_EXPONENT) {
+    Usage(argv[0]);
+    return 1;
+  }
+  if (worker_count < 1)
+    worker_count = 1;
+  if (worker_count > MAX_WORKERS)
+    worker_count = MAX_WORKERS;
+
+  InitRules(&rules, RULES_MAX_SIZE);
+  WorkerReport *reports =
+      mmap(NULL, worker_count * sizeof(WorkerReport), PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (reports == MAP_FAILED) {
+    fprintf(stderr, "ERROR: could not map worker reports\n");
+    return 1;
+  }
+
+  printf("Fuzzing %" PRIu64 " positions on %d workers, seed %" PRIu64 "\n",
+         positions_total, worker_count, seed);
+  fflush(stdout);
+  double start = GetSeconds();
+  pid_t workers[MAX_WORKERS];
+  for (int i = 0; i < worker_count; i++) {
+    uint64_t positions = positions_total / worker_count +
+                         ((uint64_t)i < positions_total % worker_count);
+    workers[i] = fork();
+    if (workers[i] < 0) {
+      fprintf(stderr, "ERROR: could not start worker %d\n", i);
+      return 1;
+    }
+    if (workers[i] == 0) {
+      RunWorker(&reports[i], positions, SeedRandom(seed ^ SeedRandom(i)),
+                max_exponent);
+      _exit(0);
+    }
+  }
+
+  int running = worker_count;
+  bool crashed = false;
+  while (running > 0) {
+    nanosleep(&(struct timespec){.tv_sec = 1}, NULL);
+    for (int i = 0; i < worker_count; i++) {
+      int status;
+      if (workers[i] <= 0 || waitpid(workers[i], &status, WNOHANG) == 0)
+        continue;
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "ERROR: worker %d crashed\n", i);
+        crashed = true;
+      }
+      workers[i] = 0;
+      running--;
+    }
+
+    uint64_t done = 0;
+    for (int i = 0; i < worker_count; i++) {
+      done += atomic_load(&reports[i].positions);
+    }
+    double seconds = GetSeconds() - start;
+    fprintf(stderr, "\r%" PRIu64 " positions, %.2f M/s", done,
+            done / seconds / 1e6);
+  }
+  fprintf(stderr, "\n");
+
+  bool failed = crashed;
+  for (Check check = 0; check < CHECK_COUNT; check++) {
+    uint64_t failures = 0, known = 0;
+    const Counterexample *smallest = NULL;
+    for (int i = 0; i < worker_count; i++) {
+      const Counterexample *example = &reports[i].counterexamples[check];
+      failures += reports[i].failures[check];
+      known += reports[i].known[check];
+      if (example->found &&
+          (smallest == NULL ||
+           CountTiles(example->board) < CountTiles(smallest->board) ||
+           (CountTiles(example->board) == CountTiles(smallest->board) &&
+            GetTileSum(&rules, example->board) <
+                GetTileSum(&rules, smallest->board))))
+        smallest = example;
+    }
+    printf("%s: %" PRIu64 " failures, %" PRIu64 " known\n",
+           check_names[check], failures, known);
+    if (smallest != NULL) {
+      PrintCounterexample(check, smallest);
+      failed = true;
+    }
+  }
+
+  munmap(reports, worker_count * sizeof(WorkerReport));
+  return failed ? 1 : 0;
+}
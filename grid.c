@@ -0,0 +1,219 @@
+#define _POSIX_C_SOURCE 200809L
+#include "palette.h"
+#include "policy.h"
+#include "rules.h"
+#include <assert.h>
+#include <pthread.h>
+#include <raylib.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// Monitoring view for bot runs: a grid of independent games played by a greedy
+// bot on worker threads. Every game is one packed board behind an atomic, so
+// the render thread snapshots it without locks. Boards are drawn by writing
+// one texel block per cell into a single texture that is scaled up to the
+// window, which keeps the whole grid at one draw call no matter how many
+// boards there are.
+
+#define WINDOW_WIDTH 800.0
+#define WINDOW_HEIGHT 800.0
+// Size of a full board in board.h, the grid keeps its aspect.
+#define BOARD_WIDTH 800.0
+#define BOARD_HEIGHT 800.0
+#define BOARD_ROWS RULES_MAX_SIZE
+#define BOARD_COLS RULES_MAX_SIZE
+#define BACKGROUND_COLOR GetColor(0x574A3EFF)
+#define EMPTY_CELL_COLOR GetColor(0x4C3F33FF)
+#define GRID_CELL_TEXELS 6
+#define GRID_GAP_TEXELS 1
+#define GRID_BOARD_TEXELS                                                      \
+  (GRID_GAP_TEXELS + BOARD_COLS * (GRID_CELL_TEXELS + GRID_GAP_TEXELS))
+#define MAX_THREADS 64
+
+typedef struct {
+  atomic_uint_fast64_t board;
+  uint64_t rng;
+} GridGame;
+
+typedef struct {
+  GridGame *games;
+  size_t begin;
+  size_t end;
+} GridWorker;
+
+static Rules rules;
+static Policy policy;
+static GridGame *games;
+static size_t games_count;
+static double moves_per_second = 10;
+static atomic_bool quit;
+static atomic_uint_fast64_t total_moves;
+
+static PackedBoard PlayGridMove(PackedBoard board, uint64_t *rng) {
+  Direction dir = ChoosePolicyMove(&policy, &rules, board, rng, 0);
+  if (dir == DIRECTION_COUNT)
+    return NewPackedGame(&rules, rng);
+  return SpawnRandom(&rules, MovePacked(&rules, board, dir), rng);
+}
+
+static double GetSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void *RunGridWorker(void *arg) {
+  GridWorker *worker = arg;
+  double interval = 1.0 / moves_per_second;
+  double next_step = GetSeconds();
+
+  while (!atomic_load_explicit(&quit, memory_order_relaxed)) {
+    for (size_t i = worker->begin; i < worker->end; i++) {
+      GridGame *game = &worker->games[i];
+      PackedBoard board =
+          atomic_load_explicit(&game->board, memory_order_relaxed);
+      atomic_store_explicit(&game->board, PlayGridMove(board, &game->rng),
+                            memory_order_release);
+    }
+    atomic_fetch_add_explicit(&total_moves, worker->end - worker->begin,
+                              memory_order_relaxed);
+
+    next_step += interval;
+    double wait = next_step - GetSeconds();
+    if (wait > 0) {
+      struct timespec sleep = {.tv_sec = (time_t)wait,
+                               .tv_nsec = (wait - (time_t)wait) * 1e9};
+      nanosleep(&sleep, NULL);
+    } else {
+      next_step = GetSeconds();
+    }
+  }
+  return NULL;
+}
+
+static void FillRect(Color *pixels, int stride, int x, int y, int size,
+                     Color color) {
+  for (int row = y; row < y + size; row++) {
+    for (int col = x; col < x + size; col++) {
+      pixels[row * stride + col] = color;
+    }
+  }
+}
+
+static void DrawGridBoards(Color *pixels, int stride, int grid_cols,
+                           const Color palette[RULES_MAX_EXPONENT + 1]) {
+  for (size_t i = 0; i < games_count; i++) {
+    PackedBoard board =
+        atomic_load_explicit(&games[i].board, memory_order_acquire);
+    int board_x = (i % grid_cols) * GRID_BOARD_TEXELS + GRID_GAP_TEXELS;
+    int board_y = (i / grid_cols) * GRID_BOARD_TEXELS + GRID_GAP_TEXELS;
+    for (int row = 0; row < BOARD_ROWS; row++) {
+      for (int col = 0; col < BOARD_COLS; col++) {
+        int exponent = GetPackedCell(&rules, board, row, col);
+        FillRect(pixels, stride,
+                 board_x + col * (GRID_CELL_TEXELS + GRID_GAP_TEXELS),
+                 board_y + row * (GRID_CELL_TEXELS + GRID_GAP_TEXELS),
+                 GRID_CELL_TEXELS, palette[exponent]);
+      }
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  int grid_cols = argc > 1 ? atoi(argv[1]) : 16;
+  int grid_rows = argc > 2 ? atoi(argv[2]) : 16;
+  if (argc > 3)
+    moves_per_second = atof(argv[3]);
+  if (grid_cols < 1 || grid_rows < 1 || moves_per_second <= 0) {
+    fprintf(stderr, "Usage: %s [cols] [rows] [moves per second]\n", argv[0]);
+    return 1;
+  }
+
+  InitRules(&rules, BOARD_ROWS);
+  ParsePolicy(&policy, "greedy");
+  games_count = (size_t)grid_cols * grid_rows;
+  games = calloc(games_count, sizeof(GridGame));
+  assert(games != NULL && "Buy more RAM lol");
+  for (size_t i = 0; i < games_count; i++) {
+    games[i].rng = SeedRandom(time(NULL) + i);
+    atomic_init(&games[i].board, NewPackedGame(&rules, &games[i].rng));
+  }
+
+  int thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+  if (thread_count < 1)
+    thread_count = 1;
+  if (thread_count > MAX_THREADS)
+    thread_count = MAX_THREADS;
+  if ((size_t)thread_count > games_count)
+    thread_count = games_count;
+  pthread_t threads[MAX_THREADS];
+  GridWorker workers[MAX_THREADS];
+  for (int i = 0; i < thread_count; i++) {
+    workers[i] = (GridWorker){.games = games,
+                              .begin = games_count * i / thread_count,
+                              .end = games_count * (i + 1) / thread_count};
+    pthread_create(&threads[i], NULL, RunGridWorker, &workers[i]);
+  }
+
+  InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "2048 Grid");
+  SetTargetFPS(60);
+
+  Color palette[RULES_MAX_EXPONENT + 1];
+  palette[0] = EMPTY_CELL_COLOR;
+  for (int exponent = 1; exponent <= RULES_MAX_EXPONENT; exponent++) {
+    palette[exponent] = GetCellColor(1 << exponent);
+  }
+
+  int texture_width = grid_cols * GRID_BOARD_TEXELS + GRID_GAP_TEXELS;
+  int texture_height = grid_rows * GRID_BOARD_TEXELS + GRID_GAP_TEXELS;
+  Image image = GenImageColor(texture_width, texture_height, BACKGROUND_COLOR);
+  Texture2D texture = LoadTextureFromImage(image);
+  SetTextureFilter(texture, TEXTURE_FILTER_POINT);
+
+  // Every board keeps the BOARD_WIDTH x BOARD_HEIGHT aspect, scaled down so
+  // the whole grid fits in the window.
+  float scale = WINDOW_WIDTH / grid_cols / BOARD_WIDTH;
+  if (WINDOW_HEIGHT / grid_rows / BOARD_HEIGHT < scale)
+    scale = WINDOW_HEIGHT / grid_rows / BOARD_HEIGHT;
+  Rectangle source = {0, 0, texture_width, texture_height};
+  Rectangle dest = {0, 0, grid_cols * BOARD_WIDTH * scale,
+                    grid_rows * BOARD_HEIGHT * scale};
+
+  uint64_t last_moves = 0;
+  double last_time = GetTime();
+  double rate = 0;
+
+  while (!WindowShouldClose()) {
+    DrawGridBoards(image.data, texture_width, grid_cols, palette);
+    UpdateTexture(texture, image.data);
+
+    if (GetTime() - last_time >= 1) {
+      uint64_t moves = atomic_load(&total_moves);
+      rate = (moves - last_moves) / (GetTime() - last_time);
+      last_moves = moves;
+      last_time = GetTime();
+    }
+
+    BeginDrawing();
+    ClearBackground(BACKGROUND_COLOR);
+    DrawTexturePro(texture, source, dest, (Vector2){0, 0}, 0, WHITE);
+    DrawFPS(4, 4);
+    DrawText(TextFormat("%zu boards, %.0f moves/s", games_count, rate), 4, 24,
+             20, LIGHTGRAY);
+    EndDrawing();
+  }
+
+  atomic_store(&quit, true);
+  for (int i = 0; i < thread_count; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  UnloadTexture(texture);
+  UnloadImage(image);
+  CloseWindow();
+  free(games);
+  return 0;
+}
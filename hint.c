@@ -0,0 +1,158 @@
+#define _POSIX_C_SOURCE 200809L
+#include "hint.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Below anything EvaluateBoard returns for a live board.
+#define LOST_SCORE -1e9f
+#define CANCEL_CHECK_INTERVAL 1024
+
+typedef struct {
+  HintEngine *engine;
+  uint32_t generation;
+  bool cancelled;
+  long nodes;
+} Search;
+
+static bool IsSearchCancelled(Search *search) {
+  if (search->cancelled)
+    return true;
+  if (++search->nodes % CANCEL_CHECK_INTERVAL != 0)
+    return false;
+
+  HintEngine *engine = search->engine;
+  if (atomic_load_explicit(&engine->quit, memory_order_relaxed) ||
+      atomic_load_explicit(&engine->request_generation,
+                           memory_order_relaxed) != search->generation) {
+    search->cancelled = true;
+  }
+  return search->cancelled;
+}
+
+static float SearchSpawns(Search *search, PackedBoard moved, int depth);
+
+static float SearchMoves(Search *search, PackedBoard board, int depth) {
+  const Rules *rules = search->engine->rules;
+  if (depth == 0)
+    return EvaluateBoard(search->engine->evaluator, board);
+
+  float best = LOST_SCORE;
+  for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+    PackedBoard moved = MovePacked(rules, board, dir);
+    if (moved == board)
+      continue;
+    float score = SearchSpawns(search, moved, depth);
+    if (score > best)
+      best = score;
+  }
+  return best;
+}
+
+static float SearchSpawns(Search *search, PackedBoard moved, int depth) {
+  if (IsSearchCancelled(search))
+    return 0;
+
+  const Rules *rules = search->engine->rules;
+  int empty_count = CountEmptyCells(rules, moved);
+  float sum = 0;
+  for (int n = 0; n < empty_count; n++) {
+    sum += SearchMoves(search, SpawnPacked(rules, moved, n), depth - 1);
+  }
+  return sum / empty_count;
+}
+
+static Direction SearchBestMove(Search *search, PackedBoard board, int depth) {
+  const Rules *rules = search->engine->rules;
+  Direction best_dir = DIRECTION_COUNT;
+  float best = 0;
+  for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+    PackedBoard moved = MovePacked(rules, board, dir);
+    if (moved == board)
+      continue;
+    float score = SearchSpawns(search, moved, depth);
+    if (best_dir == DIRECTION_COUNT || score > best) {
+      best_dir = dir;
+      best = score;
+    }
+  }
+  return best_dir;
+}
+
+static void PublishHint(HintEngine *engine, uint32_t generation, Hint hint) {
+  uint64_t packed = generation | ((uint64_t)hint.depth << 32) |
+                    ((uint64_t)hint.direction << 40);
+  atomic_store_explicit(&engine->mailbox, packed, memory_order_release);
+}
+
+static void *RunHintEngine(void *arg) {
+  HintEngine *engine = arg;
+  uint32_t searched_generation = 0;
+
+  while (!atomic_load(&engine->quit)) {
+    uint32_t generation = atomic_load_explicit(&engine->request_generation,
+                                               memory_order_acquire);
+    if (generation == searched_generation) {
+      nanosleep(&(struct timespec){.tv_nsec = 1000000}, NULL);
+      continue;
+    }
+    searched_generation = generation;
+    PackedBoard board = atomic_load(&engine->request_board);
+
+    // If the board was replaced after we read the generation, the results get
+    // tagged with the old generation and PollHint ignores them until we catch
+    // up on the next iteration.
+    Search search = {.engine = engine, .generation = generation};
+    for (int depth = 1; depth <= HINT_MAX_DEPTH; depth++) {
+      Direction dir = SearchBestMove(&search, board, depth);
+      if (search.cancelled || dir == DIRECTION_COUNT)
+        break;
+      PublishHint(engine, generation, (Hint){.direction = dir, .depth = depth});
+    }
+  }
+  return NULL;
+}
+
+void StartHintEngine(HintEngine *engine) {
+  engine->rules = malloc(sizeof(Rules));
+  assert(engine->rules != NULL && "Buy more RAM lol");
+  InitRules(engine->rules, RULES_MAX_SIZE);
+  engine->evaluator = malloc(sizeof(Evaluator));
+  assert(engine->evaluator != NULL && "Buy more RAM lol");
+  InitEvaluator(engine->evaluator, GetDefaultEvalWeights());
+
+  atomic_init(&engine->quit, false);
+  atomic_init(&engine->request_board, 0);
+  atomic_init(&engine->request_generation, 0);
+  atomic_init(&engine->mailbox, 0);
+  engine->generation = 0;
+  pthread_create(&engine->thread, NULL, RunHintEngine, engine);
+}
+
+void StopHintEngine(HintEngine *engine) {
+  atomic_store(&engine->quit, true);
+  pthread_join(engine->thread, NULL);
+  free(engine->rules);
+  free(engine->evaluator);
+  engine->rules = NULL;
+  engine->evaluator = NULL;
+}
+
+void RequestHint(HintEngine *engine, PackedBoard board) {
+  engine->generation++;
+  atomic_store(&engine->request_board, board);
+  atomic_store_explicit(&engine->request_generation, engine->generation,
+                        memory_order_release);
+}
+
+bool PollHint(HintEngine *engine, Hint *hint) {
+  uint64_t packed =
+      atomic_load_explicit(&engine->mailbox, memory_order_acquire);
+  int depth = (packed >> 32) & 0xFF;
+  if ((uint32_t)packed != engine->generation || depth == 0)
+    return false;
+
+  hint->depth = depth;
+  hint->direction = (packed >> 40) & 0xFF;
+  return true;
+}
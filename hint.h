@@ -0,0 +1,41 @@
+#ifndef HINT_H
+#define HINT_H
+
+#include "eval.h"
+#include "rules.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Expectimax search on a worker thread. The render loop hands over a packed
+// snapshot of the board with RequestHint and picks up the deepest finished
+// result with PollHint, neither of which ever waits on the worker. A new
+// request cancels the search that is running.
+
+#define HINT_MAX_DEPTH 8
+
+typedef struct {
+  Direction direction;
+  int depth;
+} Hint;
+
+typedef struct {
+  Rules *rules;
+  Evaluator *evaluator;
+  pthread_t thread;
+  atomic_bool quit;
+  atomic_uint_fast64_t request_board;
+  atomic_uint_fast32_t request_generation;
+  // generation in bits 0-31, depth in bits 32-39, direction in bits 40-47.
+  atomic_uint_fast64_t mailbox;
+  uint32_t generation;
+} HintEngine;
+
+void StartHintEngine(HintEngine *engine);
+void StopHintEngine(HintEngine *engine);
+void RequestHint(HintEngine *engine, PackedBoard board);
+// Returns false until the current request has finished its first depth.
+bool PollHint(HintEngine *engine, Hint *hint);
+
+#endif // HINT_H
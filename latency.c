@@ -0,0 +1,136 @@
+#define _POSIX_C_SOURCE 200809L
+#include "latency.h"
+#include "array.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double GetSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int CompareMilliseconds(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double Percentile(const double *sorted, size_t count, int percent) {
+  return sorted[(count - 1) * percent / 100];
+}
+
+static void ComputeLatencyStats(const LatencySample *samples, size_t count,
+                                LatencyStats *stats) {
+  memset(stats, 0, sizeof(*stats));
+  if (count == 0)
+    return;
+
+  double *display = malloc(count * sizeof(double));
+  double *settle = malloc(count * sizeof(double));
+  assert(display != NULL && settle != NULL && "Buy more RAM lol");
+  for (size_t i = 0; i < count; i++) {
+    display[stats->count++] = (samples[i].displayed - samples[i].seen) * 1e3;
+    if (samples[i].settled > 0)
+      settle[stats->settle_count++] =
+          (samples[i].settled - samples[i].seen) * 1e3;
+  }
+
+  qsort(display, stats->count, sizeof(double), CompareMilliseconds);
+  stats->display_p50 = Percentile(display, stats->count, 50);
+  stats->display_p95 = Percentile(display, stats->count, 95);
+  stats->display_max = display[stats->count - 1];
+  if (stats->settle_count > 0) {
+    qsort(settle, stats->settle_count, sizeof(double), CompareMilliseconds);
+    stats->settle_p50 = Percentile(settle, stats->settle_count, 50);
+    stats->settle_p95 = Percentile(settle, stats->settle_count, 95);
+    stats->settle_max = settle[stats->settle_count - 1];
+  }
+  free(display);
+  free(settle);
+}
+
+static bool IsSampleResolved(const LatencySample *sample) {
+  return sample->displayed > 0 && sample->settled != 0;
+}
+
+static void ResolveSamples(LatencyTracker *tracker) {
+  size_t resolved_before = tracker->first_open;
+  while (tracker->first_open < tracker->samples.count &&
+         IsSampleResolved(&tracker->samples.items[tracker->first_open])) {
+    const LatencySample *sample =
+        &tracker->samples.items[tracker->first_open++];
+    if (tracker->log == NULL)
+      continue;
+    fprintf(tracker->log, "%zu,%.6f,%.3f,", tracker->first_open,
+            sample->seen - tracker->start,
+            (sample->displayed - sample->seen) * 1e3);
+    if (sample->settled > 0)
+      fprintf(tracker->log, "%.3f", (sample->settled - sample->seen) * 1e3);
+    fprintf(tracker->log, "\n");
+  }
+  if (tracker->first_open == resolved_before)
+    return;
+
+  size_t window = tracker->first_open < LATENCY_WINDOW ? tracker->first_open
+                                                       : LATENCY_WINDOW;
+  ComputeLatencyStats(
+      &tracker->samples.items[tracker->first_open - window], window,
+      &tracker->recent);
+}
+
+bool StartLatencyTracker(LatencyTracker *tracker, const char *log_path) {
+  memset(tracker, 0, sizeof(*tracker));
+  tracker->start = GetSeconds();
+  if (log_path == NULL)
+    return true;
+
+  tracker->log = fopen(log_path, "w");
+  if (tracker->log == NULL) {
+    fprintf(stderr, "ERROR: could not open %s\n", log_path);
+    return false;
+  }
+  fprintf(tracker->log, "move,seen_s,display_ms,settle_ms\n");
+  return true;
+}
+
+void StopLatencyTracker(LatencyTracker *tracker) {
+  LatencyStats stats;
+  ComputeLatencyStats(tracker->samples.items, tracker->first_open, &stats);
+  printf("%zu moves\n", stats.count);
+  if (stats.count > 0)
+    printf("display  p50 %7.2f ms  p95 %7.2f ms  max %7.2f ms\n",
+           stats.display_p50, stats.display_p95, stats.display_max);
+  if (stats.settle_count > 0)
+    printf("settle   p50 %7.2f ms  p95 %7.2f ms  max %7.2f ms  "
+           "(%zu not interrupted)\n",
+           stats.settle_p50, stats.settle_p95, stats.settle_max,
+           stats.settle_count);
+
+  if (tracker->log != NULL)
+    fclose(tracker->log);
+  free(tracker->samples.items);
+  memset(tracker, 0, sizeof(*tracker));
+}
+
+void TrackMoveSeen(LatencyTracker *tracker) {
+  // Whatever was still animating gets cut short by this move.
+  for (size_t i = tracker->first_open; i < tracker->samples.count; i++) {
+    tracker->samples.items[i].settled = -1;
+  }
+  ResolveSamples(tracker);
+  da_append(&tracker->samples, ((LatencySample){.seen = GetSeconds()}));
+}
+
+void TrackFrameSubmitted(LatencyTracker *tracker, bool animating) {
+  double now = GetSeconds();
+  for (size_t i = tracker->first_open; i < tracker->samples.count; i++) {
+    LatencySample *sample = &tracker->samples.items[i];
+    if (sample->displayed == 0)
+      sample->displayed = now;
+    if (!animating && sample->settled == 0)
+      sample->settled = now;
+  }
+  ResolveSamples(tracker);
+}
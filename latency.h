@@ -0,0 +1,59 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Input-to-display latency of moves. The game calls TrackMoveSeen when its
+// update step picks up a move key and TrackFrameSubmitted right after every
+// EndDrawing. For each move that gives two times, both measured from the
+// update that saw the key:
+//   display  until the first frame showing the move was submitted, which
+//            includes whatever EndDrawing waits for (vsync, SetTargetFPS)
+//   settle   until the first frame submitted after its animation ended
+// A move made before the previous one settled interrupts it, interrupted
+// moves only count towards display.
+
+#define LATENCY_WINDOW 256
+
+typedef struct {
+  double seen;
+  double displayed; // 0 until a frame showed it
+  double settled;   // 0 until settled, -1 when interrupted
+} LatencySample;
+
+typedef struct {
+  size_t count;
+  double display_p50;
+  double display_p95;
+  double display_max;
+  size_t settle_count;
+  double settle_p50;
+  double settle_p95;
+  double settle_max;
+} LatencyStats;
+
+typedef struct {
+  struct {
+    LatencySample *items;
+    size_t count;
+    size_t capacity;
+  } samples;
+  // Samples before this one are settled or interrupted.
+  size_t first_open;
+  double start;
+  FILE *log;
+  // Over the last LATENCY_WINDOW moves, refreshed whenever one settles.
+  LatencyStats recent;
+} LatencyTracker;
+
+// log_path may be NULL. Writes one CSV line per move once it is resolved.
+bool StartLatencyTracker(LatencyTracker *tracker, const char *log_path);
+// Prints the stats of the whole session to stdout.
+void StopLatencyTracker(LatencyTracker *tracker);
+
+void TrackMoveSeen(LatencyTracker *tracker);
+void TrackFrameSubmitted(LatencyTracker *tracker, bool animating);
+
+#endif // LATENCY_H
@@ -1,15 +1,91 @@
 #include "board.h"
+#include "hint.h"
+#include "latency.h"
+#include "shared_state.h"
 #include <raylib.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #define WINDOW_WIDTH 800.0
 #define WINDOW_HEIGHT 800.0
 #define BACKGROUND_COLOR GetColor(0x574A3EFF)
+#define AUTO_PLAY_MIN_DEPTH 3
+
+static void DrawHint(Hint hint) {
+  static const char *direction_names[DIRECTION_COUNT] = {
+      [DIRECTION_LEFT] = "LEFT",
+      [DIRECTION_RIGHT] = "RIGHT",
+      [DIRECTION_UP] = "UP",
+      [DIRECTION_DOWN] = "DOWN",
+  };
+  DrawText(TextFormat("Hint: %s (depth %d)", direction_names[hint.direction],
+                      hint.depth),
+           CELL_GAP_SIZE, 2, 18, LIGHTGRAY);
+}
+
+static void DrawScore(Score score) {
+  const char *text =
+      TextFormat("Score: %llu", (unsigned long long)score.points);
+  DrawText(text, WINDOW_WIDTH - CELL_GAP_SIZE - MeasureText(text, 18), 2, 18,
+           LIGHTGRAY);
+}
+
+static void DrawLatency(const LatencyStats *stats) {
+  DrawText(TextFormat("Latency p50/p95/max  display %.1f/%.1f/%.1f ms  "
+                      "settle %.1f/%.1f/%.1f ms",
+                      stats->display_p50, stats->display_p95,
+                      stats->display_max, stats->settle_p50,
+                      stats->settle_p95, stats->settle_max),
+           CELL_GAP_SIZE, WINDOW_HEIGHT - 20, 18, LIGHTGRAY);
+}
+
+static Rules rules;
+
+static void PublishBoard(SharedState *shared_state, const Board *board,
+                         uint64_t frame) {
+  SharedSnapshot snapshot = {.frame = frame,
+                             .board = PackBoard(board),
+                             .score = board->score.points,
+                             .merges = board->score.merges};
+  snapshot.legal_moves = GetLegalMoves(&rules, snapshot.board);
+  for (int row = 0; row < BOARD_ROWS; row++) {
+    for (int col = 0; col < BOARD_COLS; col++) {
+      snapshot.cells[row][col] = board->cells[row][col];
+    }
+  }
+  PublishSharedSnapshot(shared_state, &snapshot);
+}
+
+int main(int argc, char **argv) {
+  bool share = false;
+  const char *latency_log = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--share") == 0) {
+      share = true;
+    } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+      latency_log = argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [--share] [--latency <log.csv>]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  SharedState *shared_state = NULL;
+  if (share) {
+    shared_state = OpenSharedState(true);
+    if (shared_state == NULL)
+      return 1;
+  }
+  LatencyTracker latency = {0};
+  if (latency_log != NULL && !StartLatencyTracker(&latency, latency_log))
+    return 1;
 
-int main(void) {
   srand(time(NULL));
+  InitRules(&rules, BOARD_ROWS);
 
   InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "2048 Game");
   SetTargetFPS(60);
@@ -17,15 +93,62 @@ int main(void) {
   Board board;
   InitBoard(&board);
 
+  HintEngine hint_engine;
+  StartHintEngine(&hint_engine);
+  RequestHint(&hint_engine, PackBoard(&board));
+  bool show_hint = false;
+  bool auto_play = false;
+  uint64_t frame = 0;
+
   while (!WindowShouldClose()) {
-    UpdateBoard(&board);
+    bool moved = UpdateBoard(&board);
+    if (moved && latency_log != NULL)
+      TrackMoveSeen(&latency);
+    Direction shared_move;
+    while (shared_state != NULL && PopSharedMove(shared_state, &shared_move)) {
+      if (MoveBoard(&board, shared_move))
+        moved = true;
+    }
+    if (IsKeyPressed(KEY_H))
+      show_hint = !show_hint;
+    if (IsKeyPressed(KEY_P))
+      auto_play = !auto_play;
+
+    // Request before polling, so a hint for the board before this frame's
+    // moves is never shown or played.
+    if (moved)
+      RequestHint(&hint_engine, PackBoard(&board));
+    Hint hint;
+    bool has_hint = PollHint(&hint_engine, &hint);
+    if (auto_play && has_hint && hint.depth >= AUTO_PLAY_MIN_DEPTH &&
+        !IsAnimationPlaying(&board.animation) &&
+        MoveBoard(&board, hint.direction)) {
+      moved = true;
+      RequestHint(&hint_engine, PackBoard(&board));
+      has_hint = false;
+    }
+    if (shared_state != NULL)
+      PublishBoard(shared_state, &board, frame);
+    frame++;
 
     BeginDrawing();
     ClearBackground(BACKGROUND_COLOR);
     DrawBoard(&board);
+    DrawScore(board.score);
+    if ((show_hint || auto_play) && has_hint)
+      DrawHint(hint);
+    if (latency_log != NULL)
+      DrawLatency(&latency.recent);
     EndDrawing();
+    if (latency_log != NULL)
+      TrackFrameSubmitted(&latency, IsAnimationPlaying(&board.animation));
   }
 
+  StopHintEngine(&hint_engine);
+  if (latency_log != NULL)
+    StopLatencyTracker(&latency);
+  if (shared_state != NULL)
+    CloseSharedState(shared_state, true);
   CloseWindow();
   return 0;
 }
@@ -0,0 +1,34 @@
+#include "palette.h"
+
+Color GetCellColor(int number) {
+  switch (number) {
+  case 2:
+    return (Color){57, 42, 26, 255};
+  case 4:
+    return (Color){71, 54, 22, 255};
+  case 8:
+    return (Color){127, 65, 11, 255};
+  case 16:
+    return (Color){141, 54, 8, 255};
+  case 32:
+    return (Color){145, 33, 7, 255};
+  case 64:
+    return (Color){167, 37, 7, 255};
+  case 128:
+    return (Color){97, 77, 12, 255};
+  case 256:
+    return (Color){237, 197, 63, 255};
+  case 512:
+    return (Color){237, 200, 80, 255};
+  case 1024:
+    return (Color){237, 197, 63, 255};
+  case 2048:
+    return (Color){237, 194, 46, 255};
+  case 4096:
+    return (Color){237, 112, 46, 255};
+  case 8192:
+    return (Color){237, 76, 46, 255};
+  default:
+    return (Color){237, 76, 46, 255};
+  };
+}
@@ -0,0 +1,10 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <raylib.h>
+
+// Tile colours of board.c, on their own so views that only need the look of
+// a tile do not pull in the board and its animations.
+Color GetCellColor(int number);
+
+#endif // PALETTE_H
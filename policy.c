@@ -0,0 +1,104 @@
+#include "policy.h"
+#include <string.h>
+
+bool ParsePolicy(Policy *policy, const char *text) {
+  memset(policy, 0, sizeof(*policy));
+  if (strcmp(text, "random") == 0) {
+    policy->type = POLICY_RANDOM;
+    return true;
+  }
+  if (strcmp(text, "greedy") == 0) {
+    policy->type = POLICY_GREEDY;
+    return true;
+  }
+  if (strncmp(text, "script:", 7) != 0)
+    return false;
+
+  policy->type = POLICY_SCRIPT;
+  for (const char *c = text + 7; *c != '\0'; c++) {
+    if (policy->script_length == POLICY_MAX_SCRIPT)
+      return false;
+    Direction dir;
+    switch (*c) {
+    case 'L':
+      dir = DIRECTION_LEFT;
+      break;
+    case 'R':
+      dir = DIRECTION_RIGHT;
+      break;
+    case 'U':
+      dir = DIRECTION_UP;
+      break;
+    case 'D':
+      dir = DIRECTION_DOWN;
+      break;
+    default:
+      return false;
+    }
+    policy->script[policy->script_length++] = dir;
+  }
+  return policy->script_length > 0;
+}
+
+static Direction ChooseRandomMove(const Rules *rules, PackedBoard board,
+                                  uint64_t *rng) {
+  Direction chosen = DIRECTION_COUNT;
+  int legal_count = 0;
+  for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+    if (MovePacked(rules, board, dir) == board)
+      continue;
+    if (NextRandom(rng) % ++legal_count == 0)
+      chosen = dir;
+  }
+  return chosen;
+}
+
+static Direction ChooseGreedyMove(const Rules *rules, PackedBoard board,
+                                  uint64_t *rng) {
+  Direction chosen = DIRECTION_COUNT;
+  int best_empty = -1;
+  int ties = 0;
+  for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+    PackedBoard moved = MovePacked(rules, board, dir);
+    if (moved == board)
+      continue;
+    int empty = CountEmptyCells(rules, moved);
+    if (empty > best_empty) {
+      chosen = dir;
+      best_empty = empty;
+      ties = 1;
+    } else if (empty == best_empty && NextRandom(rng) % ++ties == 0) {
+      chosen = dir;
+    }
+  }
+  return chosen;
+}
+
+static Direction ChooseScriptMove(const Policy *policy, const Rules *rules,
+                                  PackedBoard board, int move_index) {
+  for (int i = 0; i < policy->script_length; i++) {
+    Direction dir =
+        policy->script[(move_index + i) % policy->script_length];
+    if (MovePacked(rules, board, dir) != board)
+      return dir;
+  }
+  // The script may not cover every direction.
+  for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+    if (MovePacked(rules, board, dir) != board)
+      return dir;
+  }
+  return DIRECTION_COUNT;
+}
+
+Direction ChoosePolicyMove(const Policy *policy, const Rules *rules,
+                           PackedBoard board, uint64_t *rng, int move_index) {
+  switch (policy->type) {
+  case POLICY_RANDOM:
+    return ChooseRandomMove(rules, board, rng);
+  case POLICY_GREEDY:
+    return ChooseGreedyMove(rules, board, rng);
+  case POLICY_SCRIPT:
+    return ChooseScriptMove(policy, rules, board, move_index);
+  }
+  return DIRECTION_COUNT;
+}
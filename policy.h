@@ -0,0 +1,33 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "rules.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Simple bots for headless runs.
+//   random        any legal move
+//   greedy        the move that leaves the most empty cells
+//   script:LDRU   cycle through the letters, skipping moves that do nothing
+
+#define POLICY_MAX_SCRIPT 64
+
+typedef enum {
+  POLICY_RANDOM,
+  POLICY_GREEDY,
+  POLICY_SCRIPT,
+} PolicyType;
+
+typedef struct {
+  PolicyType type;
+  int script_length;
+  Direction script[POLICY_MAX_SCRIPT];
+} Policy;
+
+bool ParsePolicy(Policy *policy, const char *text);
+
+// Returns DIRECTION_COUNT when no move is possible.
+Direction ChoosePolicyMove(const Policy *policy, const Rules *rules,
+                           PackedBoard board, uint64_t *rng, int move_index);
+
+#endif // POLICY_H
@@ -0,0 +1,275 @@
+#include "rules.h"
+#include <string.h>
+
+static int GetRowCell(PackedRow row, int col) { return (row >> (4 * col)) & 0xF; }
+
+static PackedRow SetRowCell(PackedRow row, int col, int exponent) {
+  row &= ~(0xF << (4 * col));
+  return row | (exponent << (4 * col));
+}
+
+static PackedRow ReverseRow(PackedRow row, int size) {
+  PackedRow reversed = 0;
+  for (int col = 0; col < size; col++) {
+    reversed = SetRowCell(reversed, size - 1 - col, GetRowCell(row, col));
+  }
+  return reversed;
+}
+
+// Same walk as MoveLeft in board.c: every tile slides towards column 0 and
+// merges with an equal neighbour that has not merged yet in this move.
+// Adds the points and merges of the move to score when it is not NULL.
+static PackedRow MoveRowLeft(PackedRow row, int size, RowScore *score) {
+  PackedRow result = 0;
+  int cells[RULES_MAX_SIZE] = {0};
+  bool merge_map[RULES_MAX_SIZE] = {0};
+
+  for (int col = 0; col < size; col++) {
+    cells[col] = GetRowCell(row, col);
+  }
+
+  for (int col = 0; col < size; col++) {
+    int cell = cells[col];
+    if (cell == 0)
+      continue;
+
+    int target_col = col;
+    for (; target_col > 0; target_col--)
+      if (cells[target_col - 1] != 0)
+        break;
+
+    if (target_col > 0 && cells[target_col - 1] == cell &&
+        !merge_map[target_col - 1] && cell < RULES_MAX_EXPONENT) {
+      target_col--;
+    }
+
+    bool is_merge = col != target_col && cells[target_col] != 0;
+    cells[col] = 0;
+    cells[target_col] = is_merge ? cell + 1 : cell;
+    if (is_merge) {
+      merge_map[target_col] = true;
+      if (score != NULL) {
+        score->merges++;
+        score->points += 1 << (cell + 1);
+      }
+    }
+  }
+
+  for (int col = 0; col < size; col++) {
+    result = SetRowCell(result, col, cells[col]);
+  }
+  return result;
+}
+
+void InitRules(Rules *rules, int size) {
+  memset(rules, 0, sizeof(*rules));
+  rules->size = size;
+
+  int row_count = 1 << (4 * size);
+  for (int row = 0; row < row_count; row++) {
+    rules->row_left[row] = MoveRowLeft(row, size, &rules->row_score[row]);
+    rules->row_right[row] =
+        ReverseRow(MoveRowLeft(ReverseRow(row, size), size, NULL), size);
+  }
+}
+
+static int GetShift(const Rules *rules, int row, int col) {
+  return 4 * (row * rules->size + col);
+}
+
+int GetPackedCell(const Rules *rules, PackedBoard board, int row, int col) {
+  return (board >> GetShift(rules, row, col)) & 0xF;
+}
+
+PackedBoard SetPackedCell(const Rules *rules, PackedBoard board, int row,
+                          int col, int exponent) {
+  int shift = GetShift(rules, row, col);
+  board &= ~((PackedBoard)0xF << shift);
+  return board | ((PackedBoard)exponent << shift);
+}
+
+int GetMaxExponent(const Rules *rules, PackedBoard board) {
+  int max_exponent = 0;
+  for (int i = 0; i < rules->size * rules->size; i++) {
+    int exponent = (board >> (4 * i)) & 0xF;
+    if (exponent > max_exponent)
+      max_exponent = exponent;
+  }
+  return max_exponent;
+}
+
+int GetTileSum(const Rules *rules, PackedBoard board) {
+  int sum = 0;
+  for (int i = 0; i < rules->size * rules->size; i++) {
+    int exponent = (board >> (4 * i)) & 0xF;
+    if (exponent != 0)
+      sum += 1 << exponent;
+  }
+  return sum;
+}
+
+int CountEmptyCells(const Rules *rules, PackedBoard board) {
+  int count = 0;
+  for (int i = 0; i < rules->size * rules->size; i++) {
+    if (((board >> (4 * i)) & 0xF) == 0)
+      count++;
+  }
+  return count;
+}
+
+static PackedRow GetPackedRow(const Rules *rules, PackedBoard board, int row) {
+  int row_bits = 4 * rules->size;
+  return (board >> (row * row_bits)) & ((1 << row_bits) - 1);
+}
+
+static PackedRow GetPackedColumn(const Rules *rules, PackedBoard board,
+                                 int col) {
+  PackedRow column = 0;
+  for (int row = 0; row < rules->size; row++) {
+    column = SetRowCell(column, row, GetPackedCell(rules, board, row, col));
+  }
+  return column;
+}
+
+static PackedBoard SetPackedColumn(const Rules *rules, PackedBoard board,
+                                   int col, PackedRow column) {
+  for (int row = 0; row < rules->size; row++) {
+    board = SetPackedCell(rules, board, row, col, GetRowCell(column, row));
+  }
+  return board;
+}
+
+PackedBoard TransposePacked(PackedBoard board) {
+  PackedBoard a1 = board & 0xF0F00F0FF0F00F0Full;
+  PackedBoard a2 = board & 0x0000F0F00000F0F0ull;
+  PackedBoard a3 = board & 0x0F0F00000F0F0000ull;
+  PackedBoard a = a1 | (a2 << 12) | (a3 >> 12);
+  PackedBoard b1 = a & 0xFF00FF0000FF00FFull;
+  PackedBoard b2 = a & 0x00FF00FF00000000ull;
+  PackedBoard b3 = a & 0x00000000FF00FF00ull;
+  return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+// Shared by MovePacked and MoveScored. Inlined with score == NULL the score
+// table drops out and MovePacked only touches the row tables.
+static inline PackedBoard SlidePacked(const Rules *rules, PackedBoard board,
+                                      Direction dir, Score *score) {
+  int row_bits = 4 * rules->size;
+  PackedBoard result = 0;
+  uint64_t points = 0;
+  uint64_t merges = 0;
+
+  switch (dir) {
+  case DIRECTION_LEFT:
+  case DIRECTION_RIGHT: {
+    const PackedRow *table =
+        dir == DIRECTION_LEFT ? rules->row_left : rules->row_right;
+    for (int row = 0; row < rules->size; row++) {
+      PackedRow packed = GetPackedRow(rules, board, row);
+      result |= (PackedBoard)table[packed] << (row * row_bits);
+      if (score != NULL) {
+        points += rules->row_score[packed].points;
+        merges += rules->row_score[packed].merges;
+      }
+    }
+  } break;
+  case DIRECTION_UP:
+  case DIRECTION_DOWN: {
+    const PackedRow *table =
+        dir == DIRECTION_UP ? rules->row_left : rules->row_right;
+    if (rules->size == 4) {
+      // Columns become rows, slide them with the row table and turn back.
+      PackedBoard transposed = TransposePacked(board);
+      for (int row = 0; row < 4; row++) {
+        PackedRow packed = (transposed >> (16 * row)) & 0xFFFF;
+        result |= (PackedBoard)table[packed] << (16 * row);
+        if (score != NULL) {
+          points += rules->row_score[packed].points;
+          merges += rules->row_score[packed].merges;
+        }
+      }
+      result = TransposePacked(result);
+      break;
+    }
+    for (int col = 0; col < rules->size; col++) {
+      PackedRow packed = GetPackedColumn(rules, board, col);
+      result = SetPackedColumn(rules, result, col, table[packed]);
+      if (score != NULL) {
+        points += rules->row_score[packed].points;
+        merges += rules->row_score[packed].merges;
+      }
+    }
+  } break;
+  case DIRECTION_COUNT:
+    return board;
+  }
+
+  if (score != NULL) {
+    score->points += points;
+    score->merges += merges;
+  }
+  return result;
+}
+
+PackedBoard MovePacked(const Rules *rules, PackedBoard board, Direction dir) {
+  return SlidePacked(rules, board, dir, NULL);
+}
+
+PackedBoard MoveScored(const Rules *rules, PackedBoard board, Direction dir,
+                       Score *score) {
+  return SlidePacked(rules, board, dir, score);
+}
+
+bool CanMovePacked(const Rules *rules, PackedBoard board) {
+  for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+    if (MovePacked(rules, board, dir) != board)
+      return true;
+  }
+  return false;
+}
+
+int GetLegalMoves(const Rules *rules, PackedBoard board) {
+  int legal_moves = 0;
+  for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+    if (MovePacked(rules, board, dir) != board)
+      legal_moves |= 1 << dir;
+  }
+  return legal_moves;
+}
+
+PackedBoard SpawnPacked(const Rules *rules, PackedBoard board, int n) {
+  for (int i = 0; i < rules->size * rules->size; i++) {
+    if (((board >> (4 * i)) & 0xF) != 0)
+      continue;
+    if (n-- == 0)
+      return board | ((PackedBoard)SPAWN_EXPONENT << (4 * i));
+  }
+  return board;
+}
+
+uint64_t SeedRandom(uint64_t seed) {
+  // splitmix64, so neighbouring seeds give unrelated streams.
+  seed += 0x9E3779B97F4A7C15ull;
+  seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ull;
+  seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBull;
+  seed ^= seed >> 31;
+  return seed != 0 ? seed : 1;
+}
+
+uint64_t NextRandom(uint64_t *state) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 0x2545F4914F6CDD1Dull;
+}
+
+PackedBoard SpawnRandom(const Rules *rules, PackedBoard board, uint64_t *rng) {
+  int empty_count = CountEmptyCells(rules, board);
+  if (empty_count == 0)
+    return board;
+  return SpawnPacked(rules, board, NextRandom(rng) % empty_count);
+}
+
+PackedBoard NewPackedGame(const Rules *rules, uint64_t *rng) {
+  return SpawnRandom(rules, SpawnRandom(rules, 0, rng), rng);
+}
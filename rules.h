@@ -0,0 +1,82 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Headless version of the move and spawn rules used by board.c, working on
+// boards packed into a single integer. Every cell is a nibble holding the
+// log2 of its number (0 is an empty cell), row-major, with the top-left cell
+// in the least significant nibble.
+
+#define RULES_MIN_SIZE 3
+#define RULES_MAX_SIZE 4
+#define RULES_MAX_CELLS (RULES_MAX_SIZE * RULES_MAX_SIZE)
+#define RULES_MAX_EXPONENT 15
+#define SPAWN_EXPONENT 1
+
+typedef uint64_t PackedBoard;
+typedef uint16_t PackedRow;
+
+typedef enum {
+  DIRECTION_LEFT,
+  DIRECTION_RIGHT,
+  DIRECTION_UP,
+  DIRECTION_DOWN,
+  DIRECTION_COUNT,
+} Direction;
+
+// Points and merges of sliding one row. They are the same in both directions:
+// a run of k equal tiles merges k / 2 times whichever end it starts from.
+typedef struct {
+  uint32_t points : 24;
+  uint32_t merges : 8;
+} RowScore;
+
+typedef struct {
+  int size;
+  PackedRow row_left[1 << (4 * RULES_MAX_SIZE)];
+  PackedRow row_right[1 << (4 * RULES_MAX_SIZE)];
+  // Only MoveScored reads this, MovePacked stays on the row tables above.
+  RowScore row_score[1 << (4 * RULES_MAX_SIZE)];
+} Rules;
+
+// Running totals of a game, points as in the original game: every merge adds
+// the value of the new tile.
+typedef struct {
+  uint64_t points;
+  uint64_t merges;
+} Score;
+
+// Rules is about half a megabyte, keep it static or on the heap.
+void InitRules(Rules *rules, int size);
+
+int GetPackedCell(const Rules *rules, PackedBoard board, int row, int col);
+PackedBoard SetPackedCell(const Rules *rules, PackedBoard board, int row,
+                          int col, int exponent);
+int GetMaxExponent(const Rules *rules, PackedBoard board);
+int GetTileSum(const Rules *rules, PackedBoard board);
+int CountEmptyCells(const Rules *rules, PackedBoard board);
+
+// Swaps rows and columns of a 4x4 board.
+PackedBoard TransposePacked(PackedBoard board);
+
+PackedBoard MovePacked(const Rules *rules, PackedBoard board, Direction dir);
+// Same as MovePacked, also adds the points and merges of the move to score.
+PackedBoard MoveScored(const Rules *rules, PackedBoard board, Direction dir,
+                       Score *score);
+bool CanMovePacked(const Rules *rules, PackedBoard board);
+// Bit 1 << dir is set for every direction that changes the board.
+int GetLegalMoves(const Rules *rules, PackedBoard board);
+
+// Puts a 2 in the n-th empty cell, counting row-major like AddRandomCell.
+PackedBoard SpawnPacked(const Rules *rules, PackedBoard board, int n);
+
+// xorshift64*, small and fast enough to keep one per game or per thread.
+// The state must not be 0, SeedRandom takes care of that.
+uint64_t SeedRandom(uint64_t seed);
+uint64_t NextRandom(uint64_t *state);
+PackedBoard SpawnRandom(const Rules *rules, PackedBoard board, uint64_t *rng);
+PackedBoard NewPackedGame(const Rules *rules, uint64_t *rng);
+
+#endif // RULES_H
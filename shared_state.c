@@ -0,0 +1,114 @@
+#define _POSIX_C_SOURCE 200809L
+#include "shared_state.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+SharedState *OpenSharedState(bool create) {
+  int fd = shm_open(SHARED_STATE_NAME, create ? O_RDWR | O_CREAT : O_RDWR,
+                    0600);
+  if (fd < 0) {
+    fprintf(stderr, "ERROR: could not open shared memory %s\n",
+            SHARED_STATE_NAME);
+    return NULL;
+  }
+  if (create && ftruncate(fd, sizeof(SharedState)) != 0) {
+    fprintf(stderr, "ERROR: could not resize shared memory %s\n",
+            SHARED_STATE_NAME);
+    close(fd);
+    return NULL;
+  }
+
+  SharedState *state = mmap(NULL, sizeof(SharedState), PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd, 0);
+  close(fd);
+  if (state == MAP_FAILED) {
+    fprintf(stderr, "ERROR: could not map shared memory %s\n",
+            SHARED_STATE_NAME);
+    return NULL;
+  }
+
+  if (create) {
+    memset(state, 0, sizeof(*state));
+    atomic_init(&state->sequence, 0);
+    atomic_init(&state->closed, false);
+    atomic_init(&state->move_head, 0);
+    atomic_init(&state->move_tail, 0);
+    state->version = SHARED_STATE_VERSION;
+    atomic_thread_fence(memory_order_release);
+    state->magic = SHARED_STATE_MAGIC;
+  } else if (state->magic != SHARED_STATE_MAGIC ||
+             state->version != SHARED_STATE_VERSION) {
+    fprintf(stderr, "ERROR: %s is not a 2048 game\n", SHARED_STATE_NAME);
+    munmap(state, sizeof(SharedState));
+    return NULL;
+  }
+  return state;
+}
+
+void CloseSharedState(SharedState *state, bool created) {
+  if (created)
+    atomic_store_explicit(&state->closed, true, memory_order_release);
+  munmap(state, sizeof(SharedState));
+  if (created)
+    shm_unlink(SHARED_STATE_NAME);
+}
+
+bool IsSharedStateClosed(SharedState *state) {
+  return atomic_load_explicit(&state->closed, memory_order_acquire);
+}
+
+void PublishSharedSnapshot(SharedState *state, const SharedSnapshot *snapshot) {
+  unsigned sequence =
+      atomic_load_explicit(&state->sequence, memory_order_relaxed);
+  atomic_store_explicit(&state->sequence, sequence + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  memcpy(&state->snapshot, snapshot, sizeof(*snapshot));
+  atomic_store_explicit(&state->sequence, sequence + 2, memory_order_release);
+}
+
+bool TryReadSharedSnapshot(SharedState *state, SharedSnapshot *snapshot) {
+  for (int attempt = 0; attempt < SHARED_READ_ATTEMPTS; attempt++) {
+    if (IsSharedStateClosed(state))
+      return false;
+    unsigned before =
+        atomic_load_explicit(&state->sequence, memory_order_acquire);
+    if (before % 2 != 0)
+      continue;
+    memcpy(snapshot, &state->snapshot, sizeof(*snapshot));
+    atomic_thread_fence(memory_order_acquire);
+    unsigned after =
+        atomic_load_explicit(&state->sequence, memory_order_relaxed);
+    if (before == after)
+      return true;
+  }
+  return false;
+}
+
+bool PushSharedMove(SharedState *state, Direction dir) {
+  unsigned head = atomic_load_explicit(&state->move_head, memory_order_relaxed);
+  unsigned tail = atomic_load_explicit(&state->move_tail, memory_order_acquire);
+  if (head - tail == SHARED_MOVE_QUEUE_SIZE)
+    return false;
+  state->moves[head % SHARED_MOVE_QUEUE_SIZE] = dir;
+  atomic_store_explicit(&state->move_head, head + 1, memory_order_release);
+  return true;
+}
+
+bool PopSharedMove(SharedState *state, Direction *dir) {
+  unsigned tail = atomic_load_explicit(&state->move_tail, memory_order_relaxed);
+  unsigned head = atomic_load_explicit(&state->move_head, memory_order_acquire);
+  // Skips over garbage a misbehaving bot may have written.
+  for (; tail != head; tail++) {
+    uint8_t move = state->moves[tail % SHARED_MOVE_QUEUE_SIZE];
+    if (move >= DIRECTION_COUNT)
+      continue;
+    atomic_store_explicit(&state->move_tail, tail + 1, memory_order_release);
+    *dir = move;
+    return true;
+  }
+  atomic_store_explicit(&state->move_tail, tail, memory_order_release);
+  return false;
+}
@@ -0,0 +1,61 @@
+#ifndef SHARED_STATE_H
+#define SHARED_STATE_H
+
+#include "rules.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Live game state in a POSIX shared memory segment, for bots and dashboards
+// running in other processes.
+//
+// The game writes a SharedSnapshot every frame under a seqlock: readers retry
+// while the sequence is odd or changed under them, so the game never waits on
+// a reader. A reader gives up after SHARED_READ_ATTEMPTS, so a game that died
+// halfway through a write can not hang it. Moves go the other way through a
+// single producer, single consumer ring: the bot owns move_head, the game owns
+// move_tail. The game sets closed before it unlinks the segment, readers that
+// still map it should stop then.
+
+#define SHARED_STATE_NAME "/raylib-2048"
+#define SHARED_STATE_MAGIC 0x32303438
+#define SHARED_STATE_VERSION 2
+#define SHARED_MOVE_QUEUE_SIZE 64
+#define SHARED_READ_ATTEMPTS 1000
+
+typedef struct {
+  uint64_t frame;
+  PackedBoard board;
+  uint64_t score;
+  uint64_t merges;
+  uint32_t legal_moves;
+  int32_t cells[RULES_MAX_SIZE][RULES_MAX_SIZE];
+} SharedSnapshot;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  atomic_uint sequence;
+  atomic_bool closed;
+  SharedSnapshot snapshot;
+  atomic_uint move_head;
+  atomic_uint move_tail;
+  uint8_t moves[SHARED_MOVE_QUEUE_SIZE];
+} SharedState;
+
+// The game creates the segment, bots open the existing one.
+SharedState *OpenSharedState(bool create);
+void CloseSharedState(SharedState *state, bool created);
+bool IsSharedStateClosed(SharedState *state);
+
+void PublishSharedSnapshot(SharedState *state, const SharedSnapshot *snapshot);
+// Returns false when no consistent snapshot was seen within
+// SHARED_READ_ATTEMPTS, or when the game closed the segment.
+bool TryReadSharedSnapshot(SharedState *state, SharedSnapshot *snapshot);
+
+// Returns false when the queue is full.
+bool PushSharedMove(SharedState *state, Direction dir);
+// Returns false when the queue is empty.
+bool PopSharedMove(SharedState *state, Direction *dir);
+
+#endif // SHARED_STATE_H
@@ -0,0 +1,73 @@
+#define _POSIX_C_SOURCE 200809L
+#include "policy.h"
+#include "rules.h"
+#include "shared_state.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Example bot for `main --share`: reads the live board from shared memory and
+// sends a move back every time the game shows a new position. Stops when the
+// game closes the segment, or when it has not seen a new frame for
+// STALL_SECONDS because the game died without closing it, possibly halfway
+// through a write so that no snapshot can be read at all.
+
+#define STALL_SECONDS 5.0
+
+static Rules rules;
+
+static double GetSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+  Policy policy;
+  if (!ParsePolicy(&policy, argc > 1 ? argv[1] : "greedy")) {
+    fprintf(stderr, "Usage: %s [random|greedy|script:LDRU]\n", argv[0]);
+    return 1;
+  }
+
+  SharedState *state = OpenSharedState(false);
+  if (state == NULL)
+    return 1;
+  InitRules(&rules, RULES_MAX_SIZE);
+
+  uint64_t rng = SeedRandom(time(NULL));
+  PackedBoard last_board = 0;
+  int moves = 0;
+  uint64_t last_frame = 0;
+  double last_frame_time = GetSeconds();
+  while (!IsSharedStateClosed(state)) {
+    SharedSnapshot snapshot;
+    bool read = TryReadSharedSnapshot(state, &snapshot);
+    double now = GetSeconds();
+    if (read && snapshot.frame != last_frame) {
+      last_frame = snapshot.frame;
+      last_frame_time = now;
+    } else if (now - last_frame_time > STALL_SECONDS) {
+      fprintf(stderr, "ERROR: no new frame for %.0f seconds, giving up\n",
+              STALL_SECONDS);
+      break;
+    }
+    if (!read || snapshot.board == last_board || snapshot.legal_moves == 0) {
+      nanosleep(&(struct timespec){.tv_nsec = 100000}, NULL);
+      continue;
+    }
+
+    Direction dir =
+        ChoosePolicyMove(&policy, &rules, snapshot.board, &rng, moves);
+    if (dir == DIRECTION_COUNT || !PushSharedMove(state, dir))
+      continue;
+    last_board = snapshot.board;
+    moves++;
+    printf("frame %llu: score %llu, move %d\n",
+           (unsigned long long)snapshot.frame,
+           (unsigned long long)snapshot.score, dir);
+  }
+
+  printf("%d moves sent\n", moves);
+  CloseSharedState(state, false);
+  return 0;
+}
@@ -0,0 +1,333 @@
+#define _POSIX_C_SOURCE 200809L
+#include "policy.h"
+#include "rules.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Plays a large number of headless games with one of the policy.h bots and
+// reports what they look like. Every thread fills its own Stats and folds it
+// into the shared total after each batch of games, so memory stays fixed no
+// matter how many games are played. The main thread wakes up periodically and
+// appends a snapshot of the total to a CSV or JSON Lines file.
+
+#define MAX_THREADS 64
+#define GAMES_PER_BATCH 1024
+#define MAX_GAME_LENGTH 65535
+#define SCORE_BUCKET_WIDTH 256
+#define SCORE_BUCKETS 4096
+
+typedef struct {
+  uint64_t games;
+  uint64_t moves;
+  uint64_t merges;
+  double score_sum;
+  uint64_t directions[DIRECTION_COUNT];
+  uint64_t max_tiles[RULES_MAX_EXPONENT + 1];
+  uint64_t scores[SCORE_BUCKETS];
+  uint64_t lengths[MAX_GAME_LENGTH + 1];
+} Stats;
+
+typedef enum {
+  OUTPUT_CSV,
+  OUTPUT_JSON,
+} OutputFormat;
+
+static Rules rules;
+static Policy policy;
+static uint64_t seed;
+static uint64_t games_total;
+static atomic_uint_fast64_t next_game;
+static atomic_int finished_threads;
+
+static Stats total;
+static pthread_mutex_t total_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *direction_names[DIRECTION_COUNT] = {
+    [DIRECTION_LEFT] = "left",
+    [DIRECTION_RIGHT] = "right",
+    [DIRECTION_UP] = "up",
+    [DIRECTION_DOWN] = "down",
+};
+
+static void PlayGame(Stats *stats, uint64_t game) {
+  uint64_t rng = SeedRandom(seed ^ SeedRandom(game));
+  PackedBoard board = NewPackedGame(&rules, &rng);
+  Score score = {0};
+  int moves = 0;
+
+  for (;;) {
+    Direction dir = ChoosePolicyMove(&policy, &rules, board, &rng, moves);
+    if (dir == DIRECTION_COUNT)
+      break;
+    board = SpawnRandom(&rules, MoveScored(&rules, board, dir, &score), &rng);
+    stats->directions[dir]++;
+    moves++;
+  }
+
+  uint64_t score_bucket = score.points / SCORE_BUCKET_WIDTH;
+  stats->games++;
+  stats->moves += moves;
+  stats->merges += score.merges;
+  stats->score_sum += score.points;
+  stats->max_tiles[GetMaxExponent(&rules, board)]++;
+  stats->scores[score_bucket < SCORE_BUCKETS ? score_bucket
+                                             : SCORE_BUCKETS - 1]++;
+  stats->lengths[moves < MAX_GAME_LENGTH ? moves : MAX_GAME_LENGTH]++;
+}
+
+static void MergeStats(Stats *into, const Stats *from) {
+  into->games += from->games;
+  into->moves += from->moves;
+  into->merges += from->merges;
+  into->score_sum += from->score_sum;
+  for (int i = 0; i < DIRECTION_COUNT; i++)
+    into->directions[i] += from->directions[i];
+  for (int i = 0; i <= RULES_MAX_EXPONENT; i++)
+    into->max_tiles[i] += from->max_tiles[i];
+  for (int i = 0; i < SCORE_BUCKETS; i++)
+    into->scores[i] += from->scores[i];
+  for (int i = 0; i <= MAX_GAME_LENGTH; i++)
+    into->lengths[i] += from->lengths[i];
+}
+
+static void *RunStatsWorker(void *arg) {
+  Stats *local = arg;
+  for (;;) {
+    uint64_t first = atomic_fetch_add(&next_game, GAMES_PER_BATCH);
+    if (first >= games_total)
+      break;
+    uint64_t last = first + GAMES_PER_BATCH;
+    if (last > games_total)
+      last = games_total;
+
+    for (uint64_t game = first; game < last; game++) {
+      PlayGame(local, game);
+    }
+
+    pthread_mutex_lock(&total_mutex);
+    MergeStats(&total, local);
+    pthread_mutex_unlock(&total_mutex);
+    memset(local, 0, sizeof(*local));
+  }
+  atomic_fetch_add(&finished_threads, 1);
+  return NULL;
+}
+
+static uint64_t GetPercentile(const uint64_t *histogram, int count,
+                              uint64_t samples, double percentile) {
+  uint64_t target = ceil(samples * percentile);
+  uint64_t seen = 0;
+  for (int i = 0; i < count; i++) {
+    seen += histogram[i];
+    if (seen >= target && seen > 0)
+      return i;
+  }
+  return 0;
+}
+
+// Scores are only kept per SCORE_BUCKET_WIDTH wide bucket, so score
+// percentiles are interpolated inside the bucket they fall in as if its scores
+// were spread evenly. Scores past the last bucket are counted in it.
+static double GetScorePercentile(const Stats *stats, double percentile) {
+  uint64_t target = ceil(stats->games * percentile);
+  uint64_t seen = 0;
+  for (int i = 0; i < SCORE_BUCKETS; i++) {
+    uint64_t count = stats->scores[i];
+    if (count > 0 && seen + count >= target)
+      return SCORE_BUCKET_WIDTH * (i + (target - seen - 0.5) / count);
+    seen += count;
+  }
+  return 0;
+}
+
+static uint64_t GetMaxLength(const Stats *stats) {
+  for (int i = MAX_GAME_LENGTH; i > 0; i--) {
+    if (stats->lengths[i] > 0)
+      return i;
+  }
+  return 0;
+}
+
+static void WriteHeader(FILE *file, OutputFormat format) {
+  if (format != OUTPUT_CSV)
+    return;
+  fprintf(file, "seconds,games,moves,merges,score_mean,score_p50,score_p90,"
+                "score_p99,length_p50,length_p90,length_p99,length_max");
+  for (int i = 0; i < DIRECTION_COUNT; i++)
+    fprintf(file, ",moves_%s", direction_names[i]);
+  for (int i = 1; i <= RULES_MAX_EXPONENT; i++)
+    fprintf(file, ",max_tile_%d", 1 << i);
+  fprintf(file, "\n");
+}
+
+static void WriteSnapshot(FILE *file, OutputFormat format, const Stats *stats,
+                          double seconds) {
+  uint64_t games = stats->games;
+  double score_mean = games > 0 ? stats->score_sum / games : 0;
+  double scores[3];
+  uint64_t lengths[3];
+  double percentiles[3] = {0.5, 0.9, 0.99};
+  for (int i = 0; i < 3; i++) {
+    scores[i] = GetScorePercentile(stats, percentiles[i]);
+    lengths[i] = GetPercentile(stats->lengths, MAX_GAME_LENGTH + 1, games,
+                               percentiles[i]);
+  }
+
+  switch (format) {
+  case OUTPUT_CSV: {
+    fprintf(file,
+            "%.3f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.1f,%.0f,%.0f,%.0f,"
+            "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64,
+            seconds, games, stats->moves, stats->merges, score_mean,
+            scores[0], scores[1], scores[2], lengths[0], lengths[1],
+            lengths[2], GetMaxLength(stats));
+    for (int i = 0; i < DIRECTION_COUNT; i++)
+      fprintf(file, ",%" PRIu64, stats->directions[i]);
+    for (int i = 1; i <= RULES_MAX_EXPONENT; i++)
+      fprintf(file, ",%" PRIu64, stats->max_tiles[i]);
+    fprintf(file, "\n");
+  } break;
+  case OUTPUT_JSON: {
+    fprintf(file,
+            "{\"seconds\":%.3f,\"games\":%" PRIu64 ",\"moves\":%" PRIu64 ","
+            "\"merges\":%" PRIu64 ",\"score\":{\"mean\":%.1f,\"p50\":%.0f,"
+            "\"p90\":%.0f,\"p99\":%.0f},"
+            "\"length\":{\"p50\":%" PRIu64 ",\"p90\":%" PRIu64
+            ",\"p99\":%" PRIu64 ",\"max\":%" PRIu64 "},"
+            "\"directions\":{",
+            seconds, games, stats->moves, stats->merges, score_mean,
+            scores[0], scores[1], scores[2], lengths[0], lengths[1], lengths[2],
+            GetMaxLength(stats));
+    for (int i = 0; i < DIRECTION_COUNT; i++)
+      fprintf(file, "%s\"%s\":%" PRIu64, i > 0 ? "," : "", direction_names[i],
+              stats->directions[i]);
+    fprintf(file, "},\"max_tiles\":{");
+    for (int i = 1; i <= RULES_MAX_EXPONENT; i++)
+      fprintf(file, "%s\"%d\":%" PRIu64, i > 1 ? "," : "", 1 << i,
+              stats->max_tiles[i]);
+    fprintf(file, "}}\n");
+  } break;
+  }
+  fflush(file);
+}
+
+static double GetSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void Usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [-n games] [-p policy] [-j threads] [-s seed] "
+          "[-i seconds] [-o output.csv|output.json]\n",
+          program);
+  fprintf(stderr, "  -p policy   random, greedy or script:LDRU (default "
+                  "greedy)\n");
+  fprintf(stderr, "  -i seconds  snapshot interval (default 1)\n");
+}
+
+int main(int argc, char **argv) {
+  games_total = 100000;
+  seed = time(NULL);
+  int thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+  double interval = 1;
+  const char *policy_name = "greedy";
+  const char *output_path = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+      return 1;
+    }
+    if (strcmp(argv[i], "-n") == 0) {
+      games_total = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-p") == 0) {
+      policy_name = argv[++i];
+    } else if (strcmp(argv[i], "-j") == 0) {
+      thread_count = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-i") == 0) {
+      interval = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-o") == 0) {
+      output_path = argv[++i];
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (!ParsePolicy(&policy, policy_name) || interval <= 0) {
+    Usage(argv[0]);
+    return 1;
+  }
+  if (thread_count < 1)
+    thread_count = 1;
+  if (thread_count > MAX_THREADS)
+    thread_count = MAX_THREADS;
+
+  FILE *output = NULL;
+  OutputFormat format = OUTPUT_CSV;
+  if (output_path != NULL) {
+    const char *extension = strrchr(output_path, '.');
+    if (extension != NULL && (strcmp(extension, ".json") == 0 ||
+                              strcmp(extension, ".jsonl") == 0))
+      format = OUTPUT_JSON;
+    output = fopen(output_path, "w");
+    if (output == NULL) {
+      fprintf(stderr, "ERROR: could not open %s\n", output_path);
+      return 1;
+    }
+    WriteHeader(output, format);
+  }
+
+  InitRules(&rules, RULES_MAX_SIZE);
+
+  pthread_t threads[MAX_THREADS];
+  Stats *locals = calloc(thread_count, sizeof(Stats));
+  Stats *snapshot = malloc(sizeof(Stats));
+  assert(locals != NULL && snapshot != NULL && "Buy more RAM lol");
+  double start = GetSeconds();
+  for (int i = 0; i < thread_count; i++) {
+    pthread_create(&threads[i], NULL, RunStatsWorker, &locals[i]);
+  }
+
+  bool done;
+  do {
+    double wait = interval;
+    while (wait > 0 && atomic_load(&finished_threads) < thread_count) {
+      nanosleep(&(struct timespec){.tv_nsec = 10000000}, NULL);
+      wait -= 0.01;
+    }
+    done = atomic_load(&finished_threads) == thread_count;
+    pthread_mutex_lock(&total_mutex);
+    memcpy(snapshot, &total, sizeof(Stats));
+    pthread_mutex_unlock(&total_mutex);
+
+    double seconds = GetSeconds() - start;
+    if (output != NULL)
+      WriteSnapshot(output, format, snapshot, seconds);
+    fprintf(stderr, "\r%" PRIu64 "/%" PRIu64 " games, %.0f games/s",
+            snapshot->games, games_total, snapshot->games / seconds);
+  } while (!done);
+  fprintf(stderr, "\n");
+
+  for (int i = 0; i < thread_count; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  WriteSnapshot(stdout, OUTPUT_JSON, &total, GetSeconds() - start);
+
+  if (output != NULL)
+    fclose(output);
+  free(snapshot);
+  free(locals);
+  return 0;
+}
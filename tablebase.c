@@ -0,0 +1,152 @@
+#include "tablebase.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool LoadTablebase(Tablebase *tablebase, const char *path) {
+  memset(tablebase, 0, sizeof(*tablebase));
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "ERROR: could not open tablebase %s\n", path);
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  long file_size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  if (file_size < (long)sizeof(TablebaseHeader)) {
+    fprintf(stderr, "ERROR: %s is not a tablebase\n", path);
+    fclose(file);
+    return false;
+  }
+
+  tablebase->data = malloc(file_size);
+  assert(tablebase->data != NULL && "Buy more RAM lol");
+  tablebase->data_size = file_size;
+  size_t read = fread(tablebase->data, 1, file_size, file);
+  fclose(file);
+
+  memcpy(&tablebase->header, tablebase->data, sizeof(TablebaseHeader));
+  TablebaseHeader *header = &tablebase->header;
+  size_t index_end = sizeof(TablebaseHeader) +
+                     header->layer_count * sizeof(TablebaseLayerIndex);
+  if (read != (size_t)file_size ||
+      memcmp(header->magic, TABLEBASE_MAGIC, 4) != 0 ||
+      header->version != TABLEBASE_VERSION || header->block_size == 0 ||
+      index_end > (size_t)file_size) {
+    fprintf(stderr, "ERROR: %s is not a valid tablebase\n", path);
+    UnloadTablebase(tablebase);
+    return false;
+  }
+
+  tablebase->layers =
+      (TablebaseLayerIndex *)(tablebase->data + sizeof(TablebaseHeader));
+  for (uint32_t i = 0; i < header->layer_count; i++) {
+    TablebaseLayerIndex *layer = &tablebase->layers[i];
+    if (layer->block_count !=
+            (layer->count + header->block_size - 1) / header->block_size ||
+        layer->offset % sizeof(uint64_t) != 0 ||
+        layer->offset > (size_t)file_size ||
+        layer->block_count >
+            ((size_t)file_size - layer->offset) / sizeof(TablebaseBlock)) {
+      fprintf(stderr, "ERROR: %s has a broken layer index\n", path);
+      UnloadTablebase(tablebase);
+      return false;
+    }
+  }
+  return true;
+}
+
+void UnloadTablebase(Tablebase *tablebase) {
+  free(tablebase->data);
+  memset(tablebase, 0, sizeof(*tablebase));
+}
+
+// LEB128, 7 bits a byte. Stops at the end of the data instead of reading
+// past a broken file.
+static uint64_t ReadVarint(const unsigned char **bytes,
+                           const unsigned char *end) {
+  uint64_t value = 0;
+  for (int shift = 0; *bytes < end && shift < 64; shift += 7) {
+    unsigned char byte = *(*bytes)++;
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+      break;
+  }
+  return value;
+}
+
+bool LookupTablebase(const Tablebase *tablebase, const Rules *rules,
+                     PackedBoard board, float *probability) {
+  size_t layer = GetTileSum(rules, board) / 2;
+  if (board == 0 || layer >= tablebase->header.layer_count)
+    return false;
+
+  TablebaseLayerIndex index = tablebase->layers[layer];
+  if (index.count == 0)
+    return false;
+
+  // Last block starting at or before the board.
+  const TablebaseBlock *blocks =
+      (const TablebaseBlock *)(tablebase->data + index.offset);
+  size_t low = 0, high = index.block_count;
+  while (high - low > 1) {
+    size_t middle = (low + high) / 2;
+    if (blocks[middle].first_key <= board)
+      low = middle;
+    else
+      high = middle;
+  }
+  if (blocks[low].first_key > board ||
+      blocks[low].offset >= tablebase->data_size)
+    return false;
+
+  size_t block_size = tablebase->header.block_size;
+  size_t entries = index.count - low * block_size;
+  if (entries > block_size)
+    entries = block_size;
+  const unsigned char *bytes = tablebase->data + blocks[low].offset;
+  const unsigned char *end = tablebase->data + tablebase->data_size;
+  PackedBoard key = blocks[low].first_key;
+  for (size_t i = 0; i < entries && key <= board; i++) {
+    if (i > 0)
+      key += ReadVarint(&bytes, end);
+    float value = TABLEBASE_VALUE_SCALE - ReadVarint(&bytes, end);
+    if (key == board) {
+      *probability = value / TABLEBASE_VALUE_SCALE;
+      return true;
+    }
+  }
+  return false;
+}
+
+Direction GetTablebaseBestMove(const Tablebase *tablebase, const Rules *rules,
+                               PackedBoard board, float *probability) {
+  Direction best_dir = DIRECTION_COUNT;
+  float best_probability = 0;
+
+  for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+    PackedBoard moved = MovePacked(rules, board, dir);
+    if (moved == board)
+      continue;
+
+    int empty_count = CountEmptyCells(rules, moved);
+    float sum = 0;
+    for (int i = 0; i < empty_count; i++) {
+      float next = 0;
+      LookupTablebase(tablebase, rules, SpawnPacked(rules, moved, i), &next);
+      sum += next;
+    }
+    float expected = sum / empty_count;
+    if (best_dir == DIRECTION_COUNT || expected > best_probability) {
+      best_dir = dir;
+      best_probability = expected;
+    }
+  }
+
+  if (probability != NULL)
+    *probability = best_probability;
+  return best_dir;
+}
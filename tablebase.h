@@ -0,0 +1,74 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include "rules.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Exact win probabilities for small boards, produced offline by tbgen.c.
+//
+// Every move spawns exactly one 2, so the tile sum of a position grows by 2 on
+// each turn and positions fall into layers indexed by tile sum / 2. Within a
+// layer the positions are sorted and cut into blocks of block_size. A block
+// stores its positions as varint deltas from the previous one, each followed
+// by its 16 bit fixed point probability as a varint of 65535 minus the value,
+// since won positions are by far the most common. A lookup is a sum, a binary
+// search over the first keys of the layer's blocks and decoding one block.
+//
+// Layout: TablebaseHeader, layer_count TablebaseLayerIndex entries, then for
+// every non-empty layer block_count TablebaseBlock entries followed by the
+// encoded blocks. All fields are little endian.
+//
+// max_tiles makes a variant of the game: a position holding more tiles than
+// that is lost. Below the full board it cuts 4x4 down to something that can
+// be solved.
+
+#define TABLEBASE_MAGIC "TB48"
+#define TABLEBASE_VERSION 2
+#define TABLEBASE_VALUE_SCALE 65535.0f
+#define TABLEBASE_BLOCK_SIZE 64
+
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t size;
+  uint32_t goal;
+  uint32_t max_tiles;
+  uint32_t block_size;
+  uint32_t layer_count;
+  uint32_t reserved;
+} TablebaseHeader;
+
+typedef struct {
+  uint64_t offset;
+  uint64_t count;
+  uint64_t block_count;
+} TablebaseLayerIndex;
+
+typedef struct {
+  PackedBoard first_key;
+  uint64_t offset;
+} TablebaseBlock;
+
+typedef struct {
+  TablebaseHeader header;
+  TablebaseLayerIndex *layers;
+  unsigned char *data;
+  size_t data_size;
+} Tablebase;
+
+bool LoadTablebase(Tablebase *tablebase, const char *path);
+void UnloadTablebase(Tablebase *tablebase);
+
+// Probability of reaching the goal tile from a position where it is our turn
+// to move. Returns false when the position is not in the tablebase.
+bool LookupTablebase(const Tablebase *tablebase, const Rules *rules,
+                     PackedBoard board, float *probability);
+
+// Move with the highest probability of reaching the goal, DIRECTION_COUNT when
+// no move is possible. probability may be NULL.
+Direction GetTablebaseBestMove(const Tablebase *tablebase, const Rules *rules,
+                               PackedBoard board, float *probability);
+
+#endif // TABLEBASE_H
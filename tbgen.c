@@ -0,0 +1,415 @@
+#define _POSIX_C_SOURCE 200809L
+#include "array.h"
+#include "rules.h"
+#include "tablebase.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Offline generator for tablebase.h.
+//
+// The forward pass enumerates every position reachable from two 2s, one layer
+// (tile sum) at a time, stopping at positions that already hold the goal tile.
+// Each layer goes to a spill file once the next one is built. The backward
+// pass walks the layers from the top down: a won position is worth 1, a stuck
+// one or one over the tile limit 0, anything else the best move's average over
+// all spawns, which all live in the next layer. It reads each layer back from
+// the spill file, streams it to the tablebase once solved and drops the layer
+// above it, so either pass holds two layers at most. Both passes split a layer
+// into one chunk per thread.
+
+#define MAX_THREADS 64
+
+typedef struct {
+  PackedBoard *items;
+  size_t count;
+  size_t capacity;
+} Boards;
+
+typedef struct {
+  Boards states;
+  float *values;
+} Layer;
+
+// Where the forward pass left a layer in the spill file.
+typedef struct {
+  off_t offset;
+  size_t count;
+} SpilledLayer;
+
+typedef struct {
+  SpilledLayer *items;
+  size_t count;
+  size_t capacity;
+} SpilledLayers;
+
+typedef struct {
+  unsigned char *items;
+  size_t count;
+  size_t capacity;
+} Bytes;
+
+typedef struct {
+  const Rules *rules;
+  int goal;
+  int max_tiles;
+  const Layer *layer;
+  const Layer *next_layer;
+  size_t begin;
+  size_t end;
+  Boards successors;
+  float *values;
+} Job;
+
+static Rules rules;
+
+static int CompareBoards(const void *a, const void *b) {
+  PackedBoard x = *(const PackedBoard *)a;
+  PackedBoard y = *(const PackedBoard *)b;
+  return (x > y) - (x < y);
+}
+
+static void SortUniqueBoards(Boards *boards) {
+  if (boards->count == 0)
+    return;
+  qsort(boards->items, boards->count, sizeof(PackedBoard), CompareBoards);
+  size_t unique_count = 1;
+  for (size_t i = 1; i < boards->count; i++) {
+    if (boards->items[i] != boards->items[unique_count - 1])
+      boards->items[unique_count++] = boards->items[i];
+  }
+  boards->count = unique_count;
+}
+
+static bool IsGoalReached(const Job *job, PackedBoard board) {
+  return GetMaxExponent(job->rules, board) >= job->goal;
+}
+
+static bool IsOverTileLimit(const Job *job, PackedBoard board) {
+  int cells = job->rules->size * job->rules->size;
+  return cells - CountEmptyCells(job->rules, board) > job->max_tiles;
+}
+
+static void *ExpandChunk(void *arg) {
+  Job *job = arg;
+  for (size_t i = job->begin; i < job->end; i++) {
+    PackedBoard board = job->layer->states.items[i];
+    if (IsGoalReached(job, board))
+      continue;
+
+    for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+      PackedBoard moved = MovePacked(job->rules, board, dir);
+      if (moved == board)
+        continue;
+      int empty_count = CountEmptyCells(job->rules, moved);
+      for (int n = 0; n < empty_count; n++) {
+        PackedBoard spawned = SpawnPacked(job->rules, moved, n);
+        if (!IsOverTileLimit(job, spawned))
+          da_append(&job->successors, spawned);
+      }
+    }
+  }
+  SortUniqueBoards(&job->successors);
+  return NULL;
+}
+
+static float GetNextValue(const Job *job, PackedBoard board) {
+  const Boards *states = &job->next_layer->states;
+  PackedBoard *found = bsearch(&board, states->items, states->count,
+                               sizeof(PackedBoard), CompareBoards);
+  assert(found != NULL && "successor missing from the forward pass");
+  return job->next_layer->values[found - states->items];
+}
+
+static void *SolveChunk(void *arg) {
+  Job *job = arg;
+  for (size_t i = job->begin; i < job->end; i++) {
+    PackedBoard board = job->layer->states.items[i];
+    if (IsGoalReached(job, board)) {
+      job->values[i] = 1;
+      continue;
+    }
+
+    float best = 0;
+    for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+      PackedBoard moved = MovePacked(job->rules, board, dir);
+      if (moved == board)
+        continue;
+      int empty_count = CountEmptyCells(job->rules, moved);
+      float sum = 0;
+      for (int n = 0; n < empty_count; n++) {
+        PackedBoard spawned = SpawnPacked(job->rules, moved, n);
+        if (!IsOverTileLimit(job, spawned))
+          sum += GetNextValue(job, spawned);
+      }
+      if (sum / empty_count > best)
+        best = sum / empty_count;
+    }
+    job->values[i] = best;
+  }
+  return NULL;
+}
+
+static void RunJobs(Job *jobs, int thread_count, void *(*work)(void *)) {
+  pthread_t threads[MAX_THREADS];
+  for (int i = 0; i < thread_count; i++) {
+    pthread_create(&threads[i], NULL, work, &jobs[i]);
+  }
+  for (int i = 0; i < thread_count; i++) {
+    pthread_join(threads[i], NULL);
+  }
+}
+
+static void SplitLayer(Job *jobs, int thread_count, const Layer *layer,
+                       int goal, int max_tiles) {
+  size_t count = layer->states.count;
+  for (int i = 0; i < thread_count; i++) {
+    jobs[i] = (Job){.rules = &rules,
+                    .goal = goal,
+                    .max_tiles = max_tiles,
+                    .layer = layer,
+                    .begin = count * i / thread_count,
+                    .end = count * (i + 1) / thread_count};
+  }
+}
+
+static Layer ExpandLayer(const Layer *layer, int goal, int max_tiles,
+                         int thread_count) {
+  Job jobs[MAX_THREADS];
+  SplitLayer(jobs, thread_count, layer, goal, max_tiles);
+  RunJobs(jobs, thread_count, ExpandChunk);
+
+  Layer next = {0};
+  for (int i = 0; i < thread_count; i++) {
+    for (size_t j = 0; j < jobs[i].successors.count; j++) {
+      da_append(&next.states, jobs[i].successors.items[j]);
+    }
+    free(jobs[i].successors.items);
+  }
+  SortUniqueBoards(&next.states);
+  return next;
+}
+
+static void SolveLayer(Layer *layer, const Layer *next_layer, int goal,
+                       int max_tiles, int thread_count) {
+  layer->values = malloc(layer->states.count * sizeof(float) + 1);
+  assert(layer->values != NULL && "Buy more RAM lol");
+
+  Job jobs[MAX_THREADS];
+  SplitLayer(jobs, thread_count, layer, goal, max_tiles);
+  for (int i = 0; i < thread_count; i++) {
+    jobs[i].next_layer = next_layer;
+    jobs[i].values = layer->values;
+  }
+  RunJobs(jobs, thread_count, SolveChunk);
+}
+
+static void AppendVarint(Bytes *bytes, uint64_t value) {
+  while (value >= 0x80) {
+    da_append(bytes, (value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  da_append(bytes, value);
+}
+
+static TablebaseLayerIndex WriteLayer(FILE *file, const Layer *layer) {
+  // Block tables are read in place, keep them aligned.
+  while (ftello(file) % sizeof(uint64_t) != 0)
+    fputc(0, file);
+  size_t count = layer->states.count;
+  TablebaseLayerIndex index = {
+      .offset = ftello(file),
+      .count = count,
+      .block_count = (count + TABLEBASE_BLOCK_SIZE - 1) / TABLEBASE_BLOCK_SIZE,
+  };
+  if (count == 0)
+    return index;
+
+  TablebaseBlock *blocks = malloc(index.block_count * sizeof(TablebaseBlock));
+  assert(blocks != NULL && "Buy more RAM lol");
+  uint64_t data_offset =
+      index.offset + index.block_count * sizeof(TablebaseBlock);
+  Bytes bytes = {0};
+  for (size_t i = 0; i < count; i++) {
+    PackedBoard board = layer->states.items[i];
+    if (i % TABLEBASE_BLOCK_SIZE == 0) {
+      blocks[i / TABLEBASE_BLOCK_SIZE] = (TablebaseBlock){
+          .first_key = board, .offset = data_offset + bytes.count};
+    } else {
+      AppendVarint(&bytes, board - layer->states.items[i - 1]);
+    }
+    uint16_t value = layer->values[i] * TABLEBASE_VALUE_SCALE + 0.5f;
+    AppendVarint(&bytes, (uint16_t)TABLEBASE_VALUE_SCALE - value);
+  }
+
+  fwrite(blocks, sizeof(TablebaseBlock), index.block_count, file);
+  fwrite(bytes.items, 1, bytes.count, file);
+  free(blocks);
+  free(bytes.items);
+  return index;
+}
+
+static SpilledLayer SpillLayer(FILE *spill, const Layer *layer) {
+  SpilledLayer spilled = {.offset = ftello(spill),
+                          .count = layer->states.count};
+  if (fwrite(layer->states.items, sizeof(PackedBoard), spilled.count,
+             spill) != spilled.count) {
+    fprintf(stderr, "ERROR: could not write the spill file\n");
+    exit(1);
+  }
+  return spilled;
+}
+
+static Layer LoadSpilledLayer(FILE *spill, const SpilledLayer *spilled) {
+  Layer layer = {.states = {.count = spilled->count,
+                            .capacity = spilled->count}};
+  layer.states.items = malloc(spilled->count * sizeof(PackedBoard) + 1);
+  assert(layer.states.items != NULL && "Buy more RAM lol");
+  if (fseeko(spill, spilled->offset, SEEK_SET) != 0 ||
+      fread(layer.states.items, sizeof(PackedBoard), spilled->count, spill) !=
+          spilled->count) {
+    fprintf(stderr, "ERROR: could not read the spill file\n");
+    exit(1);
+  }
+  return layer;
+}
+
+static void FreeLayer(Layer *layer) {
+  free(layer->states.items);
+  free(layer->values);
+  memset(layer, 0, sizeof(*layer));
+}
+
+static void Usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [-s size] [-g goal] [-t tiles] [-j threads] <output>\n",
+          program);
+  fprintf(stderr, "  -s size     board size, 3 or 4 (default 3)\n");
+  fprintf(stderr, "  -g goal     goal tile as a power of two (default 8)\n");
+  fprintf(stderr, "  -t tiles    lose once more tiles than this are on the "
+                  "board (default: size * size)\n");
+  fprintf(stderr, "  -j threads  worker threads (default: all cores)\n");
+}
+
+int main(int argc, char **argv) {
+  int size = 3;
+  int goal = 8;
+  int max_tiles = 0;
+  int thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+  const char *output_path = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      size = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+      goal = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      max_tiles = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      thread_count = atoi(argv[++i]);
+    } else if (output_path == NULL && argv[i][0] != '-') {
+      output_path = argv[i];
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (max_tiles == 0)
+    max_tiles = size * size;
+  if (output_path == NULL || size < RULES_MIN_SIZE || size > RULES_MAX_SIZE ||
+      goal < 2 || goal > RULES_MAX_EXPONENT || max_tiles < 2 ||
+      max_tiles > size * size) {
+    Usage(argv[0]);
+    return 1;
+  }
+  if (thread_count < 1)
+    thread_count = 1;
+  if (thread_count > MAX_THREADS)
+    thread_count = MAX_THREADS;
+
+  InitRules(&rules, size);
+  FILE *spill = tmpfile();
+  if (spill == NULL) {
+    fprintf(stderr, "ERROR: could not create a spill file\n");
+    return 1;
+  }
+
+  // Layer 2 holds every start position: two 2s anywhere on the board.
+  SpilledLayers spilled = {0};
+  da_append(&spilled, (SpilledLayer){0});
+  da_append(&spilled, (SpilledLayer){0});
+  Layer layer = {0};
+  for (int first = 0; first < size * size; first++) {
+    for (int second = first + 1; second < size * size; second++) {
+      PackedBoard board = ((PackedBoard)SPAWN_EXPONENT << (4 * first)) |
+                          ((PackedBoard)SPAWN_EXPONENT << (4 * second));
+      da_append(&layer.states, board);
+    }
+  }
+  SortUniqueBoards(&layer.states);
+
+  size_t total = 0;
+  while (layer.states.count > 0) {
+    total += layer.states.count;
+    printf("forward: sum %4zu, %zu positions\n", 2 * spilled.count,
+           layer.states.count);
+    Layer next = ExpandLayer(&layer, goal, max_tiles, thread_count);
+    da_append(&spilled, SpillLayer(spill, &layer));
+    FreeLayer(&layer);
+    layer = next;
+  }
+  // The last layer is always empty, so it doubles as the "next" of the top.
+  da_append(&spilled, (SpilledLayer){0});
+  printf("forward: %zu positions in total\n", total);
+
+  FILE *file = fopen(output_path, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "ERROR: could not open %s\n", output_path);
+    return 1;
+  }
+
+  TablebaseHeader header = {.version = TABLEBASE_VERSION,
+                            .size = size,
+                            .goal = goal,
+                            .max_tiles = max_tiles,
+                            .block_size = TABLEBASE_BLOCK_SIZE,
+                            .layer_count = spilled.count};
+  memcpy(header.magic, TABLEBASE_MAGIC, 4);
+  TablebaseLayerIndex *index = calloc(spilled.count, sizeof(*index));
+  assert(index != NULL && "Buy more RAM lol");
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(index, sizeof(*index), spilled.count, file);
+
+  for (size_t i = spilled.count - 1; i-- > 0;) {
+    Layer solved = LoadSpilledLayer(spill, &spilled.items[i]);
+    SolveLayer(&solved, &layer, goal, max_tiles, thread_count);
+    index[i] = WriteLayer(file, &solved);
+    FreeLayer(&layer);
+    layer = solved;
+  }
+  FreeLayer(&layer);
+  fclose(spill);
+
+  fseeko(file, sizeof(header), SEEK_SET);
+  fwrite(index, sizeof(*index), spilled.count, file);
+  fseeko(file, 0, SEEK_END);
+  printf("backward: %jd bytes written\n", (intmax_t)ftello(file));
+  fclose(file);
+
+  float probability = 0;
+  Tablebase tablebase;
+  if (LoadTablebase(&tablebase, output_path)) {
+    PackedBoard board = SpawnPacked(&rules, SpawnPacked(&rules, 0, 0), 0);
+    LookupTablebase(&tablebase, &rules, board, &probability);
+    printf("backward: P(%d) from a 2 2 top row = %f\n", 1 << goal,
+           probability);
+    UnloadTablebase(&tablebase);
+  }
+
+  free(index);
+  free(spilled.items);
+  return 0;
+}
@@ -0,0 +1,195 @@
+#include "rules.h"
+#include "tablebase.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Checks a tablebase written by tbgen against a plain recursive solver that
+// knows nothing about layers, blocks or the file format. Every position the
+// solver reaches from the start positions has to be in the file with the
+// same value, the file must hold no other positions, and truncated or
+// damaged copies of it must not load. Exits with 1 if anything differs.
+
+typedef struct {
+  PackedBoard *keys;
+  float *values;
+  size_t capacity;
+  size_t count;
+} Memo;
+
+static Rules rules;
+static Tablebase tablebase;
+static Memo memo;
+static int failures;
+
+static size_t GetMemoSlot(PackedBoard board) {
+  size_t slot = (board * 0x9E3779B97F4A7C15ull) >> 32;
+  while (memo.keys[slot & (memo.capacity - 1)] != 0 &&
+         memo.keys[slot & (memo.capacity - 1)] != board)
+    slot++;
+  return slot & (memo.capacity - 1);
+}
+
+static void GrowMemo(void) {
+  Memo old = memo;
+  memo.capacity = old.capacity == 0 ? 1 << 16 : old.capacity * 2;
+  memo.keys = calloc(memo.capacity, sizeof(PackedBoard));
+  memo.values = malloc(memo.capacity * sizeof(float));
+  assert(memo.keys != NULL && memo.values != NULL && "Buy more RAM lol");
+  for (size_t i = 0; i < old.capacity; i++) {
+    if (old.keys[i] == 0)
+      continue;
+    size_t slot = GetMemoSlot(old.keys[i]);
+    memo.keys[slot] = old.keys[i];
+    memo.values[slot] = old.values[i];
+  }
+  free(old.keys);
+  free(old.values);
+}
+
+static int CountTiles(PackedBoard board) {
+  return rules.size * rules.size - CountEmptyCells(&rules, board);
+}
+
+// Probability of reaching the goal with our move next, straight from the
+// rules.
+static float Solve(PackedBoard board) {
+  size_t slot = GetMemoSlot(board);
+  if (memo.keys[slot] == board)
+    return memo.values[slot];
+
+  float value = 0;
+  if (GetMaxExponent(&rules, board) >= (int)tablebase.header.goal) {
+    value = 1;
+  } else {
+    for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+      PackedBoard moved = MovePacked(&rules, board, dir);
+      if (moved == board)
+        continue;
+      int empty_count = CountEmptyCells(&rules, moved);
+      float sum = 0;
+      for (int n = 0; n < empty_count; n++) {
+        PackedBoard spawned = SpawnPacked(&rules, moved, n);
+        if (CountTiles(spawned) <= (int)tablebase.header.max_tiles)
+          sum += Solve(spawned);
+      }
+      value = fmaxf(value, sum / empty_count);
+    }
+  }
+
+  float stored = -1;
+  if (!LookupTablebase(&tablebase, &rules, board, &stored) ||
+      fabsf(stored - value) > 1.0f / TABLEBASE_VALUE_SCALE) {
+    if (failures++ < 10)
+      fprintf(stderr, "ERROR: %016llx is %f, the tablebase says %f\n",
+              (unsigned long long)board, value, stored);
+  }
+
+  if ((memo.count + 1) * 4 > memo.capacity * 3)
+    GrowMemo();
+  slot = GetMemoSlot(board);
+  memo.keys[slot] = board;
+  memo.values[slot] = value;
+  memo.count++;
+  return value;
+}
+
+static bool LoadsFrom(const unsigned char *bytes, size_t size) {
+  const char *path = "tbtest.tmp";
+  FILE *file = fopen(path, "wb");
+  assert(file != NULL);
+  fwrite(bytes, 1, size, file);
+  fclose(file);
+
+  Tablebase copy;
+  bool loaded = LoadTablebase(&copy, path);
+  if (loaded)
+    UnloadTablebase(&copy);
+  remove(path);
+  return loaded;
+}
+
+static void CheckDamagedCopies(void) {
+  unsigned char *bytes = malloc(tablebase.data_size);
+  assert(bytes != NULL && "Buy more RAM lol");
+  memcpy(bytes, tablebase.data, tablebase.data_size);
+
+  fprintf(stderr, "The next errors are expected:\n");
+  size_t index_end = sizeof(TablebaseHeader) +
+                     tablebase.header.layer_count * sizeof(TablebaseLayerIndex);
+  if (LoadsFrom(bytes, sizeof(TablebaseHeader) - 1) ||
+      LoadsFrom(bytes, index_end - 1) ||
+      LoadsFrom(bytes, tablebase.data_size / 2)) {
+    fprintf(stderr, "ERROR: a truncated tablebase loaded\n");
+    failures++;
+  }
+  bytes[0] ^= 0xFF;
+  if (LoadsFrom(bytes, tablebase.data_size)) {
+    fprintf(stderr, "ERROR: a tablebase with a bad magic loaded\n");
+    failures++;
+  }
+  free(bytes);
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <tablebase>\n", argv[0]);
+    return 1;
+  }
+  if (!LoadTablebase(&tablebase, argv[1]))
+    return 1;
+  InitRules(&rules, tablebase.header.size);
+  GrowMemo();
+
+  int cells = rules.size * rules.size;
+  for (int first = 0; first < cells; first++) {
+    for (int second = first + 1; second < cells; second++) {
+      PackedBoard board = ((PackedBoard)SPAWN_EXPONENT << (4 * first)) |
+                          ((PackedBoard)SPAWN_EXPONENT << (4 * second));
+      float best = Solve(board);
+      float probability = -1;
+      if (GetTablebaseBestMove(&tablebase, &rules, board, &probability) ==
+              DIRECTION_COUNT ||
+          fabsf(probability - best) > 1.0f / TABLEBASE_VALUE_SCALE) {
+        fprintf(stderr, "ERROR: best move from %016llx is worth %f, not %f\n",
+                (unsigned long long)board, probability, best);
+        failures++;
+      }
+    }
+  }
+
+  uint64_t stored = 0;
+  for (uint32_t i = 0; i < tablebase.header.layer_count; i++) {
+    stored += tablebase.layers[i].count;
+  }
+  if (stored != memo.count) {
+    fprintf(stderr, "ERROR: %zu positions are reachable, the tablebase has "
+                    "%llu\n",
+            memo.count, (unsigned long long)stored);
+    failures++;
+  }
+
+  // A 2 just outside the board can not be in the tablebase of a small one.
+  float probability;
+  if (cells < RULES_MAX_CELLS &&
+      LookupTablebase(&tablebase, &rules,
+                      SpawnPacked(&rules, 0, 0) |
+                          (PackedBoard)SPAWN_EXPONENT << (4 * cells),
+                      &probability)) {
+    fprintf(stderr, "ERROR: found a position that is not on the board\n");
+    failures++;
+  }
+
+  CheckDamagedCopies();
+  printf("%dx%d, goal %d, at most %u tiles: %zu positions checked, %d "
+         "failures\n",
+         rules.size, rules.size, 1 << tablebase.header.goal,
+         tablebase.header.max_tiles, memo.count, failures);
+
+  free(memo.keys);
+  free(memo.values);
+  UnloadTablebase(&tablebase);
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,575 @@
+#define _DEFAULT_SOURCE
+#include "policy.h"
+#include "rules.h"
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Plays every policy against every seed of a range and compares the results,
+// for comparisons that run for hours or days. Game (p, i) starts from an RNG
+// state made from i and the -s seed whatever the policy, so every policy sees
+// the same openings.
+//
+// Games are handed out to forked workers one at a time. Every worker appends
+// fixed size records to its own worker-N.log in the checkpoint directory: one
+// when a game ends, and while a game is running one with its packed board,
+// RNG state and score every few seconds. That is the whole state of a game,
+// the script policy only needs the move count. A killed run started again
+// with the same policies and seed reads the logs back, skips records torn by
+// the kill or a crash, skips finished games and continues the others from
+// their last checkpoint, ending exactly where an uninterrupted run would. The
+// seed range can grow between runs, the policies and the seed can not.
+//
+// The summary is built from the logs once the workers are done, so it covers
+// every run that went into the directory.
+
+#define MAX_WORKERS 64
+#define MAX_POLICIES 16
+#define MAX_PATH 4096
+// Moves between looks at the clock while a game is running.
+#define CHECKPOINT_CHECK 64
+#define REACHED_MIN_EXPONENT 8
+#define REACHED_MAX_EXPONENT 12
+
+static const char log_magic[8] = "2048TRN1";
+
+typedef enum {
+  RECORD_PROGRESS = 1,
+  RECORD_RESULT = 2,
+} RecordType;
+
+// Written as is, 64 bytes without padding.
+typedef struct {
+  uint32_t type;
+  uint32_t policy;
+  uint64_t seed_index;
+  PackedBoard board;
+  uint64_t rng;
+  uint64_t points;
+  uint64_t merges;
+  uint64_t moves;
+  uint64_t checksum;
+} Record;
+
+_Static_assert(sizeof(Record) == 64, "Record has padding");
+
+typedef struct {
+  char magic[8];
+  uint64_t matrix;
+} LogHeader;
+
+typedef enum {
+  GAME_PENDING,
+  GAME_STARTED,
+  GAME_DONE,
+} GameStatus;
+
+typedef struct {
+  GameStatus status;
+  PackedBoard board;
+  uint64_t rng;
+  Score score;
+  uint64_t moves;
+} GameState;
+
+typedef struct {
+  atomic_uint_fast64_t next;
+  atomic_uint_fast64_t games[MAX_WORKERS];
+  atomic_uint_fast64_t moves[MAX_WORKERS];
+} SharedProgress;
+
+typedef struct {
+  FILE *log;
+  double last_sync;
+} Worker;
+
+static Rules rules;
+static Policy policies[MAX_POLICIES];
+static const char *policy_names[MAX_POLICIES];
+static int policy_count;
+static uint64_t seed;
+static uint64_t seed_count;
+static double checkpoint_interval;
+static const char *directory;
+
+static double GetSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// FNV-1a, enough to catch torn and mismatched records.
+static uint64_t HashBytes(uint64_t hash, const void *data, size_t size) {
+  const unsigned char *bytes = data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001B3;
+  }
+  return hash;
+}
+
+#define HASH_START 0xCBF29CE484222325
+
+// What records in a log are only meaningful against.
+static uint64_t HashMatrix(void) {
+  uint64_t hash = HashBytes(HASH_START, &seed, sizeof(seed));
+  for (int i = 0; i < policy_count; i++) {
+    hash = HashBytes(hash, policy_names[i], strlen(policy_names[i]) + 1);
+  }
+  return hash;
+}
+
+static uint64_t HashRecord(const Record *record) {
+  return HashBytes(HASH_START, record, offsetof(Record, checksum));
+}
+
+static void GetLogPath(char *path, int worker) {
+  snprintf(path, MAX_PATH, "%s/worker-%d.log", directory, worker);
+}
+
+static void ApplyRecord(GameState *games, const Record *record) {
+  if (record->policy >= (uint32_t)policy_count ||
+      record->seed_index >= seed_count)
+    return;
+  GameState *game = &games[record->policy * seed_count + record->seed_index];
+  if (game->status == GAME_DONE)
+    return;
+  if (record->type == RECORD_PROGRESS && game->status == GAME_STARTED &&
+      record->moves <= game->moves)
+    return;
+  game->status = record->type == RECORD_RESULT ? GAME_DONE : GAME_STARTED;
+  game->board = record->board;
+  game->rng = record->rng;
+  game->score.points = record->points;
+  game->score.merges = record->merges;
+  game->moves = record->moves;
+}
+
+static bool IsRecordValid(const Record *record) {
+  return record->checksum == HashRecord(record) &&
+         (record->type == RECORD_PROGRESS || record->type == RECORD_RESULT);
+}
+
+// Applies every good record of one log. A bad record in the middle, left by a
+// crashed machine that lost a block the records after it made it, is skipped
+// by looking for the next good one a byte further on each time, as a torn
+// record may be shorter than a whole one. Only what follows the last good
+// record is cut, so the next run appends after that instead of after a half
+// written one.
+static bool LoadLog(const char *path, uint64_t matrix, GameState *games) {
+  int fd = open(path, O_RDWR);
+  FILE *file = fd < 0 ? NULL : fdopen(fd, "r+b");
+  struct stat info;
+  if (file == NULL || fstat(fd, &info) != 0) {
+    fprintf(stderr, "ERROR: could not open %s\n", path);
+    if (file != NULL)
+      fclose(file);
+    return false;
+  }
+
+  LogHeader header;
+  off_t valid = 0;
+  if (fread(&header, sizeof(header), 1, file) == 1) {
+    if (memcmp(header.magic, log_magic, sizeof(log_magic)) != 0 ||
+        header.matrix != matrix) {
+      fprintf(stderr,
+              "ERROR: %s was written for other policies or another seed\n",
+              path);
+      fclose(file);
+      return false;
+    }
+    valid = sizeof(header);
+    size_t size = info.st_size - sizeof(header);
+    unsigned char *bytes = malloc(size + 1);
+    assert(bytes != NULL && "Buy more RAM lol");
+    if (fread(bytes, 1, size, file) != size) {
+      fprintf(stderr, "ERROR: could not read %s\n", path);
+      free(bytes);
+      fclose(file);
+      return false;
+    }
+    size_t at = 0, end = 0, skipped = 0;
+    while (at + sizeof(Record) <= size) {
+      Record record;
+      memcpy(&record, &bytes[at], sizeof(record));
+      if (!IsRecordValid(&record)) {
+        at++;
+        continue;
+      }
+      ApplyRecord(games, &record);
+      skipped += at - end;
+      at += sizeof(record);
+      end = at;
+    }
+    free(bytes);
+    if (skipped > 0)
+      fprintf(stderr, "Skipped %zu corrupt bytes in %s\n", skipped, path);
+    valid += end;
+  }
+
+  if (info.st_size > valid) {
+    fprintf(stderr, "Dropping %jd torn bytes from %s\n",
+            (intmax_t)(info.st_size - valid), path);
+    if (ftruncate(fd, valid) != 0) {
+      fprintf(stderr, "ERROR: could not truncate %s\n", path);
+      fclose(file);
+      return false;
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+static bool LoadLogs(uint64_t matrix, GameState *games) {
+  memset(games, 0, policy_count * seed_count * sizeof(GameState));
+  DIR *dir = opendir(directory);
+  if (dir == NULL) {
+    fprintf(stderr, "ERROR: could not open %s\n", directory);
+    return false;
+  }
+  bool ok = true;
+  struct dirent *entry;
+  while (ok && (entry = readdir(dir)) != NULL) {
+    int worker, end = 0;
+    sscanf(entry->d_name, "worker-%d.log%n", &worker, &end);
+    if (end == 0 || entry->d_name[end] != '\0')
+      continue;
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+    ok = LoadLog(path, matrix, games);
+  }
+  closedir(dir);
+  return ok;
+}
+
+static void WriteRecord(Worker *worker, RecordType type, uint32_t policy,
+                        uint64_t seed_index, const GameState *game) {
+  Record record = {
+      .type = type,
+      .policy = policy,
+      .seed_index = seed_index,
+      .board = game->board,
+      .rng = game->rng,
+      .points = game->score.points,
+      .merges = game->score.merges,
+      .moves = game->moves,
+  };
+  record.checksum = HashRecord(&record);
+  // Flushed every time so a killed worker loses at most the game it was on.
+  // Syncing, which also covers a crashed machine, waits for the interval.
+  if (fwrite(&record, sizeof(record), 1, worker->log) != 1 ||
+      fflush(worker->log) != 0) {
+    fprintf(stderr, "ERROR: could not write checkpoint: %s\n",
+            strerror(errno));
+    _exit(1);
+  }
+}
+
+static bool IsCheckpointDue(Worker *worker) {
+  double now = GetSeconds();
+  if (now - worker->last_sync < checkpoint_interval)
+    return false;
+  worker->last_sync = now;
+  return true;
+}
+
+static void PlayTournamentGame(Worker *worker, SharedProgress *progress,
+                               int worker_index, uint64_t index,
+                               GameState *game) {
+  uint32_t policy = index / seed_count;
+  uint64_t seed_index = index % seed_count;
+  if (game->status == GAME_PENDING) {
+    game->rng = SeedRandom(seed ^ SeedRandom(seed_index));
+    game->board = NewPackedGame(&rules, &game->rng);
+  }
+  uint64_t reported = game->moves;
+
+  for (;;) {
+    Direction dir = ChoosePolicyMove(&policies[policy], &rules, game->board,
+                                     &game->rng, game->moves);
+    if (dir == DIRECTION_COUNT)
+      break;
+    game->board = SpawnRandom(
+        &rules, MoveScored(&rules, game->board, dir, &game->score),
+        &game->rng);
+    game->moves++;
+    if (game->moves % CHECKPOINT_CHECK == 0) {
+      atomic_fetch_add(&progress->moves[worker_index],
+                       game->moves - reported);
+      reported = game->moves;
+      if (IsCheckpointDue(worker)) {
+        WriteRecord(worker, RECORD_PROGRESS, policy, seed_index, game);
+        fsync(fileno(worker->log));
+      }
+    }
+  }
+
+  WriteRecord(worker, RECORD_RESULT, policy, seed_index, game);
+  if (IsCheckpointDue(worker))
+    fsync(fileno(worker->log));
+  atomic_fetch_add(&progress->moves[worker_index], game->moves - reported);
+  atomic_fetch_add(&progress->games[worker_index], 1);
+}
+
+static void RunWorker(SharedProgress *progress, int worker_index,
+                      GameState *games, const uint64_t *pending,
+                      uint64_t pending_count) {
+  char path[MAX_PATH];
+  GetLogPath(path, worker_index);
+  Worker worker = {.log = fopen(path, "ab"), .last_sync = GetSeconds()};
+  if (worker.log == NULL) {
+    fprintf(stderr, "ERROR: could not open %s\n", path);
+    _exit(1);
+  }
+  if (ftell(worker.log) == 0) {
+    LogHeader header = {.matrix = HashMatrix()};
+    memcpy(header.magic, log_magic, sizeof(log_magic));
+    if (fwrite(&header, sizeof(header), 1, worker.log) != 1) {
+      fprintf(stderr, "ERROR: could not write %s\n", path);
+      _exit(1);
+    }
+  }
+
+  for (;;) {
+    uint64_t next = atomic_fetch_add(&progress->next, 1);
+    if (next >= pending_count)
+      break;
+    PlayTournamentGame(&worker, progress, worker_index, pending[next],
+                       &games[pending[next]]);
+  }
+  fsync(fileno(worker.log));
+  fclose(worker.log);
+}
+
+static int CompareScores(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void PrintSummary(const GameState *games) {
+  printf("%-16s %9s %10s %10s %8s %8s %8s %7s %6s", "policy", "games",
+         "score mean", "sd", "p50", "p99", "max", "moves", "best");
+  for (int e = REACHED_MIN_EXPONENT; e <= REACHED_MAX_EXPONENT; e++)
+    printf(" %5d%%", 1 << e);
+  printf("\n");
+
+  uint64_t *scores = malloc(seed_count * sizeof(uint64_t));
+  assert(scores != NULL && "Buy more RAM lol");
+  for (int p = 0; p < policy_count; p++) {
+    const GameState *row = &games[p * seed_count];
+    uint64_t done = 0, moves = 0;
+    uint64_t reached[RULES_MAX_EXPONENT + 1] = {0};
+    double sum = 0, square_sum = 0;
+    int best = 0;
+    for (uint64_t i = 0; i < seed_count; i++) {
+      if (row[i].status != GAME_DONE)
+        continue;
+      uint64_t points = row[i].score.points;
+      int max_exponent = GetMaxExponent(&rules, row[i].board);
+      scores[done++] = points;
+      moves += row[i].moves;
+      sum += points;
+      square_sum += (double)points * points;
+      reached[max_exponent]++;
+      if (max_exponent > best)
+        best = max_exponent;
+    }
+    qsort(scores, done, sizeof(uint64_t), CompareScores);
+
+    double mean = done > 0 ? sum / done : 0;
+    double variance = done > 1 ? (square_sum - sum * mean) / (done - 1) : 0;
+    printf("%-16s %9" PRIu64 " %10.1f %10.1f %8" PRIu64 " %8" PRIu64
+           " %8" PRIu64 " %7.1f %6d",
+           policy_names[p], done, mean, sqrt(variance > 0 ? variance : 0),
+           done > 0 ? scores[(done - 1) / 2] : 0,
+           done > 0 ? scores[(uint64_t)ceil(done * 0.99) - 1] : 0,
+           done > 0 ? scores[done - 1] : 0,
+           done > 0 ? (double)moves / done : 0, best > 0 ? 1 << best : 0);
+    uint64_t at_least = done;
+    for (int e = 0; e <= REACHED_MAX_EXPONENT; e++) {
+      if (e >= REACHED_MIN_EXPONENT)
+        printf(" %6.2f", done > 0 ? 100.0 * at_least / done : 0);
+      at_least -= reached[e];
+    }
+    printf("\n");
+  }
+  free(scores);
+}
+
+static bool ParsePolicies(char *list) {
+  for (char *name = strtok(list, ","); name != NULL;
+       name = strtok(NULL, ",")) {
+    if (policy_count == MAX_POLICIES ||
+        !ParsePolicy(&policies[policy_count], name))
+      return false;
+    policy_names[policy_count++] = name;
+  }
+  return policy_count > 0;
+}
+
+static void Usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s -d directory [-p policies] [-n seeds] [-s seed] "
+          "[-j workers] [-i seconds]\n",
+          program);
+  fprintf(stderr, "  -d directory  checkpoint logs, a run in the same "
+                  "directory resumes\n");
+  fprintf(stderr, "  -p policies   comma separated random, greedy or "
+                  "script:LDRU (default greedy,random)\n");
+  fprintf(stderr, "  -n seeds      games per policy (default 100000)\n");
+  fprintf(stderr, "  -s seed       mixed into the seed of every game "
+                  "(default 0)\n");
+  fprintf(stderr, "  -i seconds    checkpoint interval (default 10)\n");
+}
+
+int main(int argc, char **argv) {
+  char default_policies[] = "greedy,random";
+  char *policy_list = default_policies;
+  seed_count = 100000;
+  seed = 0;
+  checkpoint_interval = 10;
+  int worker_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+      return 1;
+    }
+    if (strcmp(argv[i], "-d") == 0) {
+      directory = argv[++i];
+    } else if (strcmp(argv[i], "-p") == 0) {
+      policy_list = argv[++i];
+    } else if (strcmp(argv[i], "-n") == 0) {
+      seed_count = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-s") == 0) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-j") == 0) {
+      worker_count = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-i") == 0) {
+      checkpoint_interval = atof(argv[++i]);
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (directory == NULL || !ParsePolicies(policy_list) || seed_count == 0 ||
+      checkpoint_interval < 0) {
+    Usage(argv[0]);
+    return 1;
+  }
+  if (worker_count < 1)
+    worker_count = 1;
+  if (worker_count > MAX_WORKERS)
+    worker_count = MAX_WORKERS;
+
+  if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "ERROR: could not create %s\n", directory);
+    return 1;
+  }
+  // Two runs on one directory would cut each other's logs on load.
+  char lock_path[MAX_PATH];
+  snprintf(lock_path, sizeof(lock_path), "%s/lock", directory);
+  int lock = open(lock_path, O_RDWR | O_CREAT, 0644);
+  if (lock < 0 || flock(lock, LOCK_EX | LOCK_NB) != 0) {
+    fprintf(stderr, "ERROR: %s is in use by another run\n", directory);
+    return 1;
+  }
+
+  InitRules(&rules, RULES_MAX_SIZE);
+  uint64_t matrix = HashMatrix();
+  uint64_t game_count = policy_count * seed_count;
+  GameState *games = malloc(game_count * sizeof(GameState));
+  uint64_t *pending = malloc(game_count * sizeof(uint64_t));
+  assert(games != NULL && pending != NULL && "Buy more RAM lol");
+  if (!LoadLogs(matrix, games))
+    return 1;
+
+  uint64_t pending_count = 0, resumed = 0;
+  for (uint64_t i = 0; i < game_count; i++) {
+    if (games[i].status != GAME_DONE)
+      pending[pending_count++] = i;
+    resumed += games[i].status == GAME_STARTED;
+  }
+  printf("%" PRIu64 " of %" PRIu64 " games left, %" PRIu64
+         " resumed from checkpoints, %d workers\n",
+         pending_count, game_count, resumed, worker_count);
+  fflush(stdout);
+
+  SharedProgress *progress =
+      mmap(NULL, sizeof(SharedProgress), PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (progress == MAP_FAILED) {
+    fprintf(stderr, "ERROR: could not map worker progress\n");
+    return 1;
+  }
+
+  double start = GetSeconds();
+  pid_t workers[MAX_WORKERS] = {0};
+  for (int i = 0; i < worker_count && pending_count > 0; i++) {
+    workers[i] = fork();
+    if (workers[i] < 0) {
+      fprintf(stderr, "ERROR: could not start worker %d\n", i);
+      return 1;
+    }
+    if (workers[i] == 0) {
+      RunWorker(progress, i, games, pending, pending_count);
+      _exit(0);
+    }
+  }
+
+  int running = 0;
+  for (int i = 0; i < worker_count; i++) {
+    running += workers[i] > 0;
+  }
+  bool crashed = false;
+  while (running > 0) {
+    nanosleep(&(struct timespec){.tv_sec = 1}, NULL);
+    for (int i = 0; i < worker_count; i++) {
+      int status;
+      if (workers[i] <= 0 || waitpid(workers[i], &status, WNOHANG) == 0)
+        continue;
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "ERROR: worker %d crashed\n", i);
+        crashed = true;
+      }
+      workers[i] = 0;
+      running--;
+    }
+
+    uint64_t done = 0, moves = 0;
+    for (int i = 0; i < worker_count; i++) {
+      done += atomic_load(&progress->games[i]);
+      moves += atomic_load(&progress->moves[i]);
+    }
+    double seconds = GetSeconds() - start;
+    fprintf(stderr, "\r%" PRIu64 "/%" PRIu64 " games, %.0f games/s, "
+                    "%.2f M moves/s",
+            done, pending_count, done / seconds, moves / seconds / 1e6);
+  }
+  if (pending_count > 0)
+    fprintf(stderr, "\n");
+
+  if (!LoadLogs(matrix, games))
+    return 1;
+  PrintSummary(games);
+
+  munmap(progress, sizeof(SharedProgress));
+  free(pending);
+  free(games);
+  close(lock);
+  return crashed ? 1 : 0;
+}
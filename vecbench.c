@@ -0,0 +1,190 @@
+#define _POSIX_C_SOURCE 200809L
+#include "rules.h"
+#include "vecenv.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Steps a VecEnv with random actions, a few of them illegal on purpose. The
+// first rounds check every buffer against the env's own boards and rules.c,
+// the rest are timed without checks.
+
+#define DEFAULT_ENVS 1024
+#define DEFAULT_STEPS 4096
+#define CHECKED_STEPS 256
+// One action in ILLEGAL_EVERY is drawn from all values, legal or not.
+#define ILLEGAL_EVERY 16
+
+static Rules rules;
+
+static double GetSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void *AllocateAligned(size_t size) {
+  size = (size + VEC_ENV_ALIGNMENT - 1) / VEC_ENV_ALIGNMENT * VEC_ENV_ALIGNMENT;
+  void *pointer = aligned_alloc(VEC_ENV_ALIGNMENT, size);
+  assert(pointer != NULL && "Buy more RAM lol");
+  return pointer;
+}
+
+static void ChooseActions(const VecEnv *env, const VecEnvBuffers *buffers,
+                          int32_t *actions, uint64_t *rng) {
+  for (int i = 0; i < env->count; i++) {
+    uint64_t random = NextRandom(rng);
+    if (random % ILLEGAL_EVERY == 0) {
+      actions[i] = (int32_t)((random >> 32) % (DIRECTION_COUNT + 2)) - 1;
+      continue;
+    }
+    const uint8_t *legal = &buffers->legal_actions[i * DIRECTION_COUNT];
+    int legal_count = 0;
+    int legal_dirs[DIRECTION_COUNT];
+    for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+      if (legal[dir])
+        legal_dirs[legal_count++] = dir;
+    }
+    actions[i] = legal_dirs[(random >> 32) % legal_count];
+  }
+}
+
+// Returns the number of mismatches between the buffers and the games.
+static int CheckBuffers(const VecEnv *env, const VecEnvBuffers *buffers,
+                        const PackedBoard *before, const int32_t *actions) {
+  int failures = 0;
+  for (int i = 0; i < env->count; i++) {
+    PackedBoard board = env->boards[i];
+    const uint8_t *observation =
+        &buffers->observations[i * VEC_ENV_OBSERVATION_SIZE];
+    for (int cell = 0; cell < RULES_MAX_CELLS; cell++) {
+      int exponent = (board >> (4 * cell)) & 0xF;
+      for (int plane = 0; plane < VEC_ENV_PLANES; plane++) {
+        if (observation[plane * RULES_MAX_CELLS + cell] != (plane == exponent))
+          failures++;
+      }
+    }
+
+    int legal_moves = GetLegalMoves(&rules, board);
+    for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+      if (buffers->legal_actions[i * DIRECTION_COUNT + dir] !=
+          ((legal_moves >> dir) & 1))
+        failures++;
+    }
+
+    bool is_illegal = actions[i] < 0 || actions[i] >= DIRECTION_COUNT ||
+                      MovePacked(&rules, before[i], actions[i]) == before[i];
+    if (buffers->illegal[i] != is_illegal ||
+        (is_illegal && (board != before[i] || buffers->rewards[i] != 0 ||
+                        buffers->dones[i] != 0)))
+      failures++;
+    if (is_illegal)
+      continue;
+    Score score = {0};
+    PackedBoard moved = MoveScored(&rules, before[i], actions[i], &score);
+    if (buffers->rewards[i] != score.points)
+      failures++;
+    // A finished game was reset already, otherwise one 2 was spawned.
+    if (!buffers->dones[i] && CountEmptyCells(&rules, board) !=
+                                  CountEmptyCells(&rules, moved) - 1)
+      failures++;
+  }
+  return failures;
+}
+
+static void Usage(const char *program) {
+  fprintf(stderr, "Usage: %s [-n envs] [-t steps] [-s seed]\n", program);
+}
+
+int main(int argc, char **argv) {
+  int env_count = DEFAULT_ENVS;
+  int step_count = DEFAULT_STEPS;
+  uint64_t seed = 1;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+      return 1;
+    }
+    if (strcmp(argv[i], "-n") == 0) {
+      env_count = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-t") == 0) {
+      step_count = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (env_count < 1 || step_count < 1) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  InitRules(&rules, RULES_MAX_SIZE);
+  VecEnv *env = CreateVecEnv(env_count, seed);
+  VecEnvBuffers buffers = {
+      .observations = AllocateAligned(env_count * VEC_ENV_OBSERVATION_SIZE),
+      .rewards = AllocateAligned(env_count * sizeof(float)),
+      .dones = AllocateAligned(env_count),
+      .legal_actions = AllocateAligned(env_count * DIRECTION_COUNT),
+      .episode_scores = AllocateAligned(env_count * sizeof(float)),
+      .illegal = AllocateAligned(env_count),
+  };
+  int32_t *actions = malloc(env_count * sizeof(int32_t));
+  PackedBoard *before = malloc(env_count * sizeof(PackedBoard));
+  assert(actions != NULL && before != NULL && "Buy more RAM lol");
+
+  uint64_t rng = SeedRandom(seed);
+  ResetVecEnv(env, &buffers);
+  int failures = 0;
+  for (int step = 0; step < CHECKED_STEPS; step++) {
+    ChooseActions(env, &buffers, actions, &rng);
+    memcpy(before, env->boards, env_count * sizeof(PackedBoard));
+    // Every buffer has to be written on every step, a trainer may hand over
+    // a different set of arrays each time.
+    memset(buffers.observations, 0xAA, env_count * VEC_ENV_OBSERVATION_SIZE);
+    memset(buffers.rewards, 0xAA, env_count * sizeof(float));
+    memset(buffers.dones, 0xAA, env_count);
+    memset(buffers.legal_actions, 0xAA, env_count * DIRECTION_COUNT);
+    memset(buffers.illegal, 0xAA, env_count);
+    StepVecEnv(env, actions, &buffers);
+    failures += CheckBuffers(env, &buffers, before, actions);
+  }
+  if (failures > 0) {
+    fprintf(stderr, "ERROR: %d mismatches in %d checked steps\n", failures,
+            CHECKED_STEPS);
+    return 1;
+  }
+
+  // Picking the actions is timed too, a trainer has to do the same.
+  uint64_t episodes = 0;
+  double start = GetSeconds();
+  for (int step = 0; step < step_count; step++) {
+    ChooseActions(env, &buffers, actions, &rng);
+    StepVecEnv(env, actions, &buffers);
+    for (int i = 0; i < env_count; i++) {
+      episodes += buffers.dones[i];
+    }
+  }
+  double seconds = GetSeconds() - start;
+
+  printf("checked: %d steps of %d envs\n", CHECKED_STEPS, env_count);
+  printf("steps:   %.2f M env steps/s, %llu episodes\n",
+         (double)step_count * env_count / seconds / 1e6,
+         (unsigned long long)episodes);
+
+  free(actions);
+  free(before);
+  free(buffers.observations);
+  free(buffers.rewards);
+  free(buffers.dones);
+  free(buffers.legal_actions);
+  free(buffers.episode_scores);
+  free(buffers.illegal);
+  DestroyVecEnv(env);
+  return 0;
+}
@@ -0,0 +1,129 @@
+#include "vecenv.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+VecEnv *CreateVecEnv(int count, uint64_t seed) {
+  VecEnv *env = calloc(1, sizeof(VecEnv));
+  assert(env != NULL && "Buy more RAM lol");
+  env->rules = malloc(sizeof(Rules));
+  env->boards = calloc(count, sizeof(*env->boards));
+  env->rngs = calloc(count, sizeof(*env->rngs));
+  env->scores = calloc(count, sizeof(*env->scores));
+  env->moved = calloc(count, sizeof(*env->moved));
+  env->points = calloc(count, sizeof(*env->points));
+  assert(env->rules != NULL && env->boards != NULL && env->rngs != NULL &&
+         env->scores != NULL && env->moved != NULL && env->points != NULL &&
+         "Buy more RAM lol");
+
+  InitRules(env->rules, RULES_MAX_SIZE);
+  env->count = count;
+  for (int i = 0; i < count; i++) {
+    env->rngs[i] = SeedRandom(seed ^ SeedRandom(i));
+  }
+  return env;
+}
+
+void DestroyVecEnv(VecEnv *env) {
+  free(env->rules);
+  free(env->boards);
+  free(env->rngs);
+  free(env->scores);
+  free(env->moved);
+  free(env->points);
+  free(env);
+}
+
+static bool IsAligned(const void *pointer) {
+  return (uintptr_t)pointer % VEC_ENV_ALIGNMENT == 0;
+}
+
+// Moves the board every way once, fills in the legal mask and returns whether
+// any move is left.
+static bool PrepareMoves(VecEnv *env, int i, uint8_t *legal_actions) {
+  bool any_legal = false;
+  for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+    Score score = {0};
+    PackedBoard moved = MoveScored(env->rules, env->boards[i], dir, &score);
+    env->moved[i][dir] = moved;
+    env->points[i][dir] = score.points;
+    legal_actions[dir] = moved != env->boards[i];
+    any_legal |= legal_actions[dir];
+  }
+  return any_legal;
+}
+
+// Legal mask of the moves PrepareMoves already made, without moving again.
+static void WriteLegalActions(const VecEnv *env, int i,
+                              uint8_t *legal_actions) {
+  for (int dir = 0; dir < DIRECTION_COUNT; dir++) {
+    legal_actions[dir] = env->moved[i][dir] != env->boards[i];
+  }
+}
+
+static void WriteObservation(PackedBoard board, uint8_t *observation) {
+  memset(observation, 0, VEC_ENV_OBSERVATION_SIZE);
+  for (int cell = 0; cell < RULES_MAX_CELLS; cell++) {
+    int exponent = (board >> (4 * cell)) & 0xF;
+    observation[exponent * RULES_MAX_CELLS + cell] = 1;
+  }
+}
+
+static void ResetGame(VecEnv *env, int i, const VecEnvBuffers *buffers) {
+  env->boards[i] = NewPackedGame(env->rules, &env->rngs[i]);
+  env->scores[i] = 0;
+  PrepareMoves(env, i, &buffers->legal_actions[i * DIRECTION_COUNT]);
+  WriteObservation(env->boards[i],
+                   &buffers->observations[i * VEC_ENV_OBSERVATION_SIZE]);
+}
+
+void ResetVecEnv(VecEnv *env, const VecEnvBuffers *buffers) {
+  assert(IsAligned(buffers->observations) && IsAligned(buffers->rewards) &&
+         IsAligned(buffers->dones) && IsAligned(buffers->legal_actions));
+  for (int i = 0; i < env->count; i++) {
+    ResetGame(env, i, buffers);
+    buffers->rewards[i] = 0;
+    buffers->dones[i] = 0;
+    if (buffers->illegal != NULL)
+      buffers->illegal[i] = 0;
+  }
+}
+
+void StepVecEnv(VecEnv *env, const int32_t *actions,
+                const VecEnvBuffers *buffers) {
+  assert(IsAligned(buffers->observations) && IsAligned(buffers->rewards) &&
+         IsAligned(buffers->dones) && IsAligned(buffers->legal_actions));
+
+  for (int i = 0; i < env->count; i++) {
+    int32_t action = actions[i];
+    buffers->dones[i] = 0;
+    bool is_illegal = action < 0 || action >= DIRECTION_COUNT ||
+                      env->moved[i][action] == env->boards[i];
+    if (buffers->illegal != NULL)
+      buffers->illegal[i] = is_illegal;
+    if (is_illegal) {
+      buffers->rewards[i] = 0;
+      WriteLegalActions(env, i,
+                        &buffers->legal_actions[i * DIRECTION_COUNT]);
+      WriteObservation(env->boards[i],
+                       &buffers->observations[i * VEC_ENV_OBSERVATION_SIZE]);
+      continue;
+    }
+
+    env->boards[i] =
+        SpawnRandom(env->rules, env->moved[i][action], &env->rngs[i]);
+    env->scores[i] += env->points[i][action];
+    buffers->rewards[i] = env->points[i][action];
+
+    if (PrepareMoves(env, i, &buffers->legal_actions[i * DIRECTION_COUNT])) {
+      WriteObservation(env->boards[i],
+                       &buffers->observations[i * VEC_ENV_OBSERVATION_SIZE]);
+      continue;
+    }
+
+    buffers->dones[i] = 1;
+    if (buffers->episode_scores != NULL)
+      buffers->episode_scores[i] = env->scores[i];
+    ResetGame(env, i, buffers);
+  }
+}
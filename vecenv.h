@@ -0,0 +1,61 @@
+#ifndef VECENV_H
+#define VECENV_H
+
+#include "rules.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Batched reinforcement learning environment on top of rules.h.
+//
+// One VecEnv holds count independent games and steps all of them per call.
+// Results are written into caller-owned arrays laid out env after env, which
+// must be aligned to VEC_ENV_ALIGNMENT:
+//   observations   count * VEC_ENV_OBSERVATION_SIZE bytes, one plane of
+//                  cells per log2 value, 1 where the cell holds that value
+//   rewards        count floats, points scored by the move
+//   dones          count bytes, 1 when the episode just ended
+//   legal_actions  count * DIRECTION_COUNT bytes, 1 where the move is legal
+// An episode that ends is reset right away, so its observation is already the
+// first one of the next episode. Illegal actions leave the board untouched
+// and give no reward, the observation and legal mask are written again all
+// the same. Trainers that want to punish them read the illegal flags.
+//
+// Nothing is allocated after CreateVecEnv. A VecEnv is not thread safe, run
+// one per thread to use more cores.
+
+#define VEC_ENV_ALIGNMENT 64
+#define VEC_ENV_PLANES (RULES_MAX_EXPONENT + 1)
+#define VEC_ENV_OBSERVATION_SIZE (VEC_ENV_PLANES * RULES_MAX_CELLS)
+
+typedef struct {
+  uint8_t *observations;
+  float *rewards;
+  uint8_t *dones;
+  uint8_t *legal_actions;
+  // Optional, final score of every episode that ended in this step.
+  float *episode_scores;
+  // Optional, count bytes, 1 when the action was out of range or did not
+  // change the board.
+  uint8_t *illegal;
+} VecEnvBuffers;
+
+typedef struct {
+  Rules *rules;
+  int count;
+  PackedBoard *boards;
+  uint64_t *rngs;
+  uint64_t *scores;
+  // Every direction is moved once per step, the chosen one is reused.
+  PackedBoard (*moved)[DIRECTION_COUNT];
+  uint32_t (*points)[DIRECTION_COUNT];
+} VecEnv;
+
+VecEnv *CreateVecEnv(int count, uint64_t seed);
+void DestroyVecEnv(VecEnv *env);
+
+void ResetVecEnv(VecEnv *env, const VecEnvBuffers *buffers);
+void StepVecEnv(VecEnv *env, const int32_t *actions,
+                const VecEnvBuffers *buffers);
+
+#endif // VECENV_H